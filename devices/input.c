@@ -2,14 +2,19 @@
 #include <debug.h>
 #include "devices/intq.h"
 #include "devices/serial.h"
+#include "threads/wait.h"
 
 /* Stores keys from the keyboard and serial port. */
 static struct intq buffer;
 
+/* Threads in poll() waiting for a key. */
+static struct wait_queue pollers;
+
 /* Initializes the input buffer. */
 void
 input_init (void) {
 	intq_init (&buffer);
+	wait_queue_init (&pollers);
 }
 
 /* Adds a key to the input buffer.
@@ -21,6 +26,7 @@ input_putc (uint8_t key) {
 
 	intq_putc (&buffer, key);
 	serial_notify ();
+	wait_queue_wake (&pollers);
 }
 
 /* Retrieves a key from the input buffer.
@@ -38,6 +44,21 @@ input_getc (void) {
 	return key;
 }
 
+/* Returns true if a key is waiting in the input buffer, so that
+   input_getc() will not wait.  Puts PT, if not null, on the queue
+   of threads to wake when a key arrives. */
+bool
+input_poll (struct poll_table *pt) {
+	enum intr_level old_level;
+	bool ready;
+
+	poll_table_add (pt, &pollers);
+	old_level = intr_disable ();
+	ready = !intq_empty (&buffer);
+	intr_set_level (old_level);
+	return ready;
+}
+
 /* Returns true if the input buffer is full,
    false otherwise.
    Interrupts must be off. */
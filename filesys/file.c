@@ -1,13 +1,21 @@
 #include "filesys/file.h"
 #include <debug.h>
 #include "filesys/inode.h"
+#include "filesys/pipe.h"
 #include "threads/malloc.h"
 
 /* An open file. */
 struct file {
-	struct inode *inode;        /* File's inode. */
+	struct inode *inode;        /* File's inode, null for a pipe or the
+	                               console. */
 	off_t pos;                  /* Current position. */
 	bool deny_write;            /* Has file_deny_write() been called? */
+	struct pipe *pipe;          /* Pipe that this is an end of. */
+	bool pipe_writer;           /* Write end of PIPE, not read end? */
+	bool console;               /* The console? */
+	bool console_writer;        /* Display of the console, not keyboard? */
+	int ref_cnt;                /* References; see file_share(). */
+	struct file *dup;           /* See file_duplicate_once(). */
 };
 
 /* Opens a file for the given INODE, of which it takes ownership,
@@ -20,6 +28,7 @@ file_open (struct inode *inode) {
 		file->inode = inode;
 		file->pos = 0;
 		file->deny_write = false;
+		file->ref_cnt = 1;
 		return file;
 	} else {
 		inode_close (inode);
@@ -28,6 +37,43 @@ file_open (struct inode *inode) {
 	}
 }
 
+/* Opens a file for the write end of PIPE if WRITER is true, for
+ * its read end otherwise, taking ownership of a reference to that
+ * end, and returns the new file.  Returns a null pointer if an
+ * allocation fails or if PIPE is null.  The file has no inode:
+ * it can only be read or written with pipe_read() or pipe_write(),
+ * and duplicated or closed. */
+struct file *
+file_open_pipe (struct pipe *pipe, bool writer) {
+	struct file *file = calloc (1, sizeof *file);
+	if (pipe != NULL && file != NULL) {
+		file->pipe = pipe;
+		file->pipe_writer = writer;
+		file->ref_cnt = 1;
+		return file;
+	} else {
+		if (pipe != NULL)
+			pipe_close (pipe, writer);
+		free (file);
+		return NULL;
+	}
+}
+
+/* Opens a file for the console's display if WRITER is true, for its
+ * keyboard otherwise, and returns the new file.  Returns a null pointer
+ * if an allocation fails.  Like a pipe end, the file has no inode: it
+ * can only be read or written, one way, and duplicated or closed. */
+struct file *
+file_open_console (bool writer) {
+	struct file *file = calloc (1, sizeof *file);
+	if (file != NULL) {
+		file->console = true;
+		file->console_writer = writer;
+		file->ref_cnt = 1;
+	}
+	return file;
+}
+
 /* Opens and returns a new file for the same inode as FILE.
  * Returns a null pointer if unsuccessful. */
 struct file *
@@ -39,7 +85,14 @@ file_reopen (struct file *file) {
  * same inode as FILE. Returns a null pointer if unsuccessful. */
 struct file *
 file_duplicate (struct file *file) {
-	struct file *nfile = file_open (inode_reopen (file->inode));
+	struct file *nfile;
+
+	if (file->pipe != NULL)
+		return file_open_pipe (pipe_reopen (file->pipe, file->pipe_writer),
+				file->pipe_writer);
+	if (file->console)
+		return file_open_console (file->console_writer);
+	nfile = file_open (inode_reopen (file->inode));
 	if (nfile) {
 		nfile->pos = file->pos;
 		if (file->deny_write)
@@ -48,12 +101,49 @@ file_duplicate (struct file *file) {
 	return nfile;
 }
 
-/* Closes FILE. */
+/* Like file_duplicate(), but the first call for FILE remembers the
+ * duplicate in FILE, and later calls return another reference to it
+ * instead of a new one, until file_forget_duplicate().  Copying a
+ * table in which several descriptors share FILE thus shares a single
+ * duplicate in the same way, without searching for it. */
+struct file *
+file_duplicate_once (struct file *file) {
+	if (file->dup != NULL)
+		return file_share (file->dup);
+	file->dup = file_duplicate (file);
+	return file->dup;
+}
+
+/* Forgets the duplicate remembered by file_duplicate_once(). */
+void
+file_forget_duplicate (struct file *file) {
+	file->dup = NULL;
+}
+
+/* Returns FILE with another reference to it, for another file
+ * descriptor that shares its position.  Each reference is
+ * dropped with file_close(). */
+struct file *
+file_share (struct file *file) {
+	file->ref_cnt++;
+	return file;
+}
+
+/* Returns true if FILE has more than one reference. */
+bool
+file_is_shared (const struct file *file) {
+	return file->ref_cnt > 1;
+}
+
+/* Drops a reference to FILE, closing it with the last one. */
 void
 file_close (struct file *file) {
-	if (file != NULL) {
+	if (file != NULL && --file->ref_cnt == 0) {
 		file_allow_write (file);
-		inode_close (file->inode);
+		if (file->pipe != NULL)
+			pipe_close (file->pipe, file->pipe_writer);
+		else if (!file->console)
+			inode_close (file->inode);
 		free (file);
 	}
 }
@@ -64,6 +154,23 @@ file_get_inode (struct file *file) {
 	return file->inode;
 }
 
+/* Returns the pipe that FILE is the write end of if WRITER is
+ * true, or the read end of otherwise, or a null pointer if FILE is
+ * not that end of a pipe. */
+struct pipe *
+file_get_pipe (struct file *file, bool writer) {
+	if (file->pipe == NULL || file->pipe_writer != writer)
+		return NULL;
+	return file->pipe;
+}
+
+/* Returns true if FILE is the console's display if WRITER is true, or its
+ * keyboard otherwise. */
+bool
+file_is_console (const struct file *file, bool writer) {
+	return file->console && file->console_writer == writer;
+}
+
 /* Reads SIZE bytes from FILE into BUFFER,
  * starting at the file's current position.
  * Returns the number of bytes actually read,
@@ -113,6 +220,64 @@ file_write_at (struct file *file, const void *buffer, off_t size,
 	return inode_write_at (file->inode, buffer, size, file_ofs);
 }
 
+/* Reads SIZE bytes from FILE into the buffers of IT, starting at the
+ * file's current position.  Returns the number of bytes actually
+ * read, as file_read().  Advances FILE's position by the number of
+ * bytes read. */
+off_t
+file_read_iter (struct file *file, struct iov_iter *it, off_t size) {
+	off_t bytes_read = inode_read_iter (file->inode, it, size, file->pos);
+	file->pos += bytes_read;
+	return bytes_read;
+}
+
+/* Reads SIZE bytes from FILE into the buffers of IT, starting at
+ * offset FILE_OFS in the file.  Returns the number of bytes actually
+ * read, as file_read_at().  The file's current position is
+ * unaffected. */
+off_t
+file_read_iter_at (struct file *file, struct iov_iter *it, off_t size,
+		off_t file_ofs) {
+	return inode_read_iter (file->inode, it, size, file_ofs);
+}
+
+/* Writes SIZE bytes from the buffers of IT into FILE, starting at the
+ * file's current position.  Returns the number of bytes actually
+ * written, as file_write().  Advances FILE's position by the number
+ * of bytes written. */
+off_t
+file_write_iter (struct file *file, struct iov_iter *it, off_t size) {
+	off_t bytes_written = inode_write_iter (file->inode, it, size,
+			file->pos);
+	file->pos += bytes_written;
+	return bytes_written;
+}
+
+/* Writes SIZE bytes from the buffers of IT into FILE, starting at
+ * offset FILE_OFS in the file.  Returns the number of bytes actually
+ * written, as file_write_at().  The file's current position is
+ * unaffected. */
+off_t
+file_write_iter_at (struct file *file, struct iov_iter *it, off_t size,
+		off_t file_ofs) {
+	return inode_write_iter (file->inode, it, size, file_ofs);
+}
+
+/* Copies SIZE bytes from IN into OUT, each starting at its file's
+ * current position, inside the kernel.  IN and OUT must not refer
+ * to overlapping ranges of the same file.
+ * Returns the number of bytes actually copied, which may be less
+ * than SIZE if end of either file is reached.
+ * Advances both files' positions by the number of bytes copied. */
+off_t
+file_copy_range (struct file *out, struct file *in, off_t size) {
+	off_t bytes_copied = inode_copy_at (out->inode, out->pos,
+			in->inode, in->pos, size);
+	in->pos += bytes_copied;
+	out->pos += bytes_copied;
+	return bytes_copied;
+}
+
 /* Prevents write operations on FILE's underlying inode
  * until file_allow_write() is called or FILE is closed. */
 void
@@ -6,6 +6,7 @@
 #include "filesys/free-map.h"
 #include "filesys/inode.h"
 #include "filesys/directory.h"
+#include "filesys/page_cache.h"
 #include "devices/disk.h"
 
 /* The disk that contains the file system. */
@@ -51,6 +52,10 @@ filesys_done (void) {
 #else
 	free_map_close ();
 #endif
+#ifdef VM
+	/* Files that are still open keep their data in the cache. */
+	page_cache_flush ();
+#endif
 }
 
 /* Creates a file named NAME with the given INITIAL_SIZE.
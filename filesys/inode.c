@@ -1,11 +1,15 @@
 #include "filesys/inode.h"
 #include <list.h>
 #include <debug.h>
+#include <iov.h>
 #include <round.h>
 #include <string.h>
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
+#include "filesys/page_cache.h"
 #include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -34,6 +38,11 @@ struct inode {
 	bool removed;                       /* True if deleted, false otherwise. */
 	int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
 	struct inode_disk data;             /* Inode content. */
+	struct exec_image *exec_image;      /* Parsed executable, or null. */
+	bool mapped_writable;               /* Data may change without writes. */
+#ifdef VM
+	struct list cache_pages;            /* Pages of data in the page cache. */
+#endif
 };
 
 /* Returns the disk sector that contains byte offset POS within
@@ -125,6 +134,11 @@ inode_open (disk_sector_t sector) {
 	inode->open_cnt = 1;
 	inode->deny_write_cnt = 0;
 	inode->removed = false;
+	inode->exec_image = NULL;
+	inode->mapped_writable = false;
+#ifdef VM
+	list_init (&inode->cache_pages);
+#endif
 	disk_read (filesys_disk, inode->sector, &inode->data);
 	return inode;
 }
@@ -157,6 +171,12 @@ inode_close (struct inode *inode) {
 		/* Remove from inode list and release lock. */
 		list_remove (&inode->elem);
 
+#ifdef VM
+		/* Drop its cached data, which nobody can reach any more.  Data of
+		 * a removed inode is not worth writing back. */
+		page_cache_release (inode, !inode->removed);
+#endif
+
 		/* Deallocate blocks if removed. */
 		if (inode->removed) {
 			free_map_release (inode->sector, 1);
@@ -164,6 +184,7 @@ inode_close (struct inode *inode) {
 					bytes_to_sectors (inode->data.length)); 
 		}
 
+		free (inode->exec_image);
 		free (inode); 
 	}
 }
@@ -176,14 +197,38 @@ inode_remove (struct inode *inode) {
 	inode->removed = true;
 }
 
+/* Reads SIZE bytes from INODE into the buffers of IT, starting at
+ * position OFFSET.  Returns the number of bytes actually read, as
+ * inode_read_at(). */
+off_t
+inode_read_iter (struct inode *inode, struct iov_iter *it, off_t size,
+		off_t offset) {
+#ifdef VM
+	return page_cache_read (inode, it, size, offset);
+#else
+	return inode_read_direct (inode, it, size, offset);
+#endif
+}
+
 /* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
  * Returns the number of bytes actually read, which may be less
  * than SIZE if an error occurs or end of file is reached. */
 off_t
-inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
-	uint8_t *buffer = buffer_;
+inode_read_at (struct inode *inode, void *buffer, off_t size, off_t offset) {
+	struct iov_iter it;
+
+	iov_iter_init_buf (&it, buffer, size);
+	return inode_read_iter (inode, &it, size, offset);
+}
+
+/* Like inode_read_at(), but reads SIZE bytes into the buffers of IT and
+ * from the disk, bypassing the page cache. */
+off_t
+inode_read_direct (struct inode *inode, struct iov_iter *it, off_t size,
+		off_t offset) {
 	off_t bytes_read = 0;
 	uint8_t *bounce = NULL;
+	void *dst;
 
 	while (size > 0) {
 		/* Disk sector to read, starting byte offset within sector. */
@@ -200,9 +245,11 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 		if (chunk_size <= 0)
 			break;
 
-		if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE) {
+		if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE
+				&& (dst = iov_iter_contig (it, DISK_SECTOR_SIZE)) != NULL) {
 			/* Read full sector directly into caller's buffer. */
-			disk_read (filesys_disk, sector_idx, buffer + bytes_read); 
+			disk_read (filesys_disk, sector_idx, dst);
+			iov_iter_advance (it, DISK_SECTOR_SIZE);
 		} else {
 			/* Read sector into bounce buffer, then partially copy
 			 * into caller's buffer. */
@@ -212,7 +259,7 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 					break;
 			}
 			disk_read (filesys_disk, sector_idx, bounce);
-			memcpy (buffer + bytes_read, bounce + sector_ofs, chunk_size);
+			iov_iter_copy_to (it, bounce + sector_ofs, chunk_size);
 		}
 
 		/* Advance. */
@@ -225,20 +272,47 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 	return bytes_read;
 }
 
+/* Writes SIZE bytes from the buffers of IT into INODE, starting at
+ * OFFSET, unless writes to INODE are denied.  Returns the number of
+ * bytes actually written, as inode_write_at(). */
+off_t
+inode_write_iter (struct inode *inode, struct iov_iter *it, off_t size,
+		off_t offset) {
+	if (inode->deny_write_cnt)
+		return 0;
+	if (inode->exec_image != NULL)
+		inode_set_exec_image (inode, NULL);
+
+#ifdef VM
+	return page_cache_write (inode, it, size, offset);
+#else
+	return inode_write_direct (inode, it, size, offset);
+#endif
+}
+
 /* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
  * Returns the number of bytes actually written, which may be
  * less than SIZE if end of file is reached or an error occurs.
  * (Normally a write at end of file would extend the inode, but
  * growth is not yet implemented.) */
 off_t
-inode_write_at (struct inode *inode, const void *buffer_, off_t size,
+inode_write_at (struct inode *inode, const void *buffer, off_t size,
+		off_t offset) {
+	struct iov_iter it;
+
+	iov_iter_init_buf (&it, (void *) buffer, size);
+	return inode_write_iter (inode, &it, size, offset);
+}
+
+/* Like inode_write_at(), but writes SIZE bytes from the buffers of IT and
+ * to the disk, bypassing the page cache and ignoring
+ * inode_deny_write(). */
+off_t
+inode_write_direct (struct inode *inode, struct iov_iter *it, off_t size,
 		off_t offset) {
-	const uint8_t *buffer = buffer_;
 	off_t bytes_written = 0;
 	uint8_t *bounce = NULL;
-
-	if (inode->deny_write_cnt)
-		return 0;
+	void *src;
 
 	while (size > 0) {
 		/* Sector to write, starting byte offset within sector. */
@@ -255,9 +329,11 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 		if (chunk_size <= 0)
 			break;
 
-		if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE) {
+		if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE
+				&& (src = iov_iter_contig (it, DISK_SECTOR_SIZE)) != NULL) {
 			/* Write full sector directly to disk. */
-			disk_write (filesys_disk, sector_idx, buffer + bytes_written); 
+			disk_write (filesys_disk, sector_idx, src);
+			iov_iter_advance (it, DISK_SECTOR_SIZE);
 		} else {
 			/* We need a bounce buffer. */
 			if (bounce == NULL) {
@@ -273,7 +349,7 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 				disk_read (filesys_disk, sector_idx, bounce);
 			else
 				memset (bounce, 0, DISK_SECTOR_SIZE);
-			memcpy (bounce + sector_ofs, buffer + bytes_written, chunk_size);
+			iov_iter_copy_from (it, bounce + sector_ofs, chunk_size);
 			disk_write (filesys_disk, sector_idx, bounce); 
 		}
 
@@ -287,6 +363,61 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 	return bytes_written;
 }
 
+/* Copies SIZE bytes from SRC, starting at SRC_OFS, into DST, starting at
+ * DST_OFS, without passing them through a caller's buffer.  The ranges
+ * must not overlap if SRC and DST are the same inode.  Returns the number
+ * of bytes actually copied, which is less than SIZE at the end of either
+ * inode, and 0 if writes to DST are denied. */
+off_t
+inode_copy_at (struct inode *dst, off_t dst_ofs, struct inode *src,
+		off_t src_ofs, off_t size) {
+	if (dst->deny_write_cnt)
+		return 0;
+	if (dst->exec_image != NULL)
+		inode_set_exec_image (dst, NULL);
+
+#ifdef VM
+	return page_cache_copy (dst, dst_ofs, src, src_ofs, size);
+#else
+	return inode_copy_direct (dst, dst_ofs, src, src_ofs, size);
+#endif
+}
+
+/* Like inode_copy_at(), but copies from disk to disk a page at a time,
+ * bypassing the page cache and ignoring inode_deny_write(). */
+off_t
+inode_copy_direct (struct inode *dst, off_t dst_ofs, struct inode *src,
+		off_t src_ofs, off_t size) {
+	off_t bytes_copied = 0;
+	uint8_t *bounce = palloc_get_page (0);
+
+	if (bounce == NULL)
+		return 0;
+	while (size > 0) {
+		off_t chunk_size = size < PGSIZE ? size : PGSIZE;
+		struct iov_iter it;
+		off_t n;
+
+		iov_iter_init_buf (&it, bounce, chunk_size);
+		n = inode_read_direct (src, &it, chunk_size, src_ofs);
+		if (n <= 0)
+			break;
+		iov_iter_init_buf (&it, bounce, n);
+		n = inode_write_direct (dst, &it, n, dst_ofs);
+		if (n <= 0)
+			break;
+
+		/* Advance. */
+		size -= n;
+		src_ofs += n;
+		dst_ofs += n;
+		bytes_copied += n;
+	}
+	palloc_free_page (bounce);
+
+	return bytes_copied;
+}
+
 /* Disables writes to INODE.
    May be called at most once per inode opener. */
 	void
@@ -306,8 +437,49 @@ inode_allow_write (struct inode *inode) {
 	inode->deny_write_cnt--;
 }
 
+/* Returns the executable image cached for INODE by
+ * inode_set_exec_image(), or a null pointer if there is none. */
+struct exec_image *
+inode_get_exec_image (const struct inode *inode) {
+	return inode->exec_image;
+}
+
+/* Caches IMAGE, a single block from malloc(), as the executable
+ * parsed from INODE's data, in place of any earlier one.  Writes
+ * to INODE drop it, and so does closing INODE for the last time.
+ * IMAGE may be null to just drop the cached image.  Returns true
+ * if INODE took ownership of IMAGE, false if INODE's data can
+ * change without writes to it, so it cannot be cached. */
+bool
+inode_set_exec_image (struct inode *inode, struct exec_image *image) {
+	free (inode->exec_image);
+	inode->exec_image = NULL;
+	if (inode->mapped_writable)
+		return false;
+	inode->exec_image = image;
+	return true;
+}
+
+/* Notes that INODE is mapped writable into memory, so that its
+ * data may change without writes to it.  Its executable image is
+ * no longer cached while it stays open. */
+void
+inode_map_writable (struct inode *inode) {
+	inode_set_exec_image (inode, NULL);
+	inode->mapped_writable = true;
+}
+
 /* Returns the length, in bytes, of INODE's data. */
 off_t
 inode_length (const struct inode *inode) {
 	return inode->data.length;
 }
+
+#ifdef VM
+/* Returns the list of INODE's pages in the page cache, which belongs to
+ * the page cache. */
+struct list *
+inode_cache_pages (struct inode *inode) {
+	return &inode->cache_pages;
+}
+#endif
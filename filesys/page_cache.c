@@ -1,6 +1,17 @@
 /* page_cache.c: Implementation of Page Cache (Buffer Cache). */
 
 #include "vm/vm.h"
+#include "filesys/page_cache.h"
+#include <hash.h>
+#include <iov.h>
+#include <stdlib.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "filesys/file.h"
+#include "filesys/inode.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
 static bool page_cache_readahead (struct page *page, void *kva);
 static bool page_cache_writeback (struct page *page);
 static void page_cache_destroy (struct page *page);
@@ -15,10 +26,85 @@ static const struct page_operations page_cache_op = {
 
 tid_t page_cache_workerd;
 
+#ifdef VM
+/* The page cache.
+ *
+ * File data lives in cache pages of PGSIZE bytes, one per page-aligned
+ * page of a file, kept on a list per inode.  read() and write() copy to
+ * and from the cache pages, and mmaped file pages map them directly into
+ * the page tables of the processes instead of getting frames of their own.
+ * Both paths therefore see the same copy of the data, and it is never
+ * cached twice.
+ *
+ * A cache page is dirty if write() stored into it, or if the dirty bit of
+ * any page that maps it is set.  The worker thread writes dirty pages back
+ * every WRITEBACK_INTERVAL ticks, in batches of WRITEBACK_BATCH sorted by
+ * position on disk.  Pages are also written back when they are evicted and
+ * when the last opener of their inode closes it, after which they are
+ * dropped.
+ *
+ * The cache holds at most cache_limit pages from the user pool.  Past
+ * that, and whenever the user pool runs dry, the clock hand evicts the
+ * cache page that has gone longest without being read, written or
+ * accessed through a mapping, unmapping it from every page that maps it.
+ *
+ * cache_lock protects everything here, including the cache links of the
+ * pages that map cache pages.  It is not held while data is copied to or
+ * from a caller's buffer, which may be user memory that faults, nor while
+ * a page is read from disk, so that a miss does not hold up every other
+ * lookup; the cache page is pinned instead.  A page being read is in the
+ * cache but marked loading, and lookups of it wait on the page until the
+ * read is done. */
+#define WRITEBACK_INTERVAL (TIMER_FREQ / 2)
+#define WRITEBACK_BATCH 32
+
+/* A page of file data in the cache. */
+struct cache_page {
+	struct hash_elem elem;       /* Element in cache_pages. */
+	struct list_elem lru_elem;   /* Element in cache_lru. */
+	struct list_elem inode_elem; /* Element in the inode's list. */
+	struct inode *inode;         /* File the data belongs to. */
+	size_t index;                /* Page index in the file. */
+	void *kva;                   /* The data. */
+	struct list mappers;         /* Pages that map KVA, through their
+	                                file_page's cache_elem. */
+	int pin_cnt;                 /* Number of copies in progress. */
+	bool loading;                /* Being read from disk? */
+	struct condition loaded;     /* Signaled when LOADING is cleared. */
+	bool dirty;                  /* Written to by write()? */
+	bool referenced;             /* Read or written since the last sweep? */
+};
+
+static struct hash cache_pages;         /* Cache pages by inode and index. */
+static struct list cache_lru;           /* Cache pages in clock order. */
+static struct lock cache_lock;
+static struct condition cache_unpinned; /* Signaled when a pin drops to 0. */
+static size_t cache_cnt;                /* Number of cache pages. */
+static size_t cache_limit;              /* Maximum number of cache pages. */
+static bool cache_ready;                /* Set once pagecache_init() ran. */
+
+static thread_func page_cache_kworkerd NO_RETURN;
+static hash_hash_func cache_page_hash;
+static hash_less_func cache_page_less;
+#endif
+
 /* The initializer of file vm */
 void
 pagecache_init (void) {
-	/* TODO: Create a worker daemon for page cache with page_cache_kworkerd */
+#ifdef VM
+	hash_init (&cache_pages, cache_page_hash, cache_page_less, NULL);
+	list_init (&cache_lru);
+	lock_init (&cache_lock);
+	cond_init (&cache_unpinned);
+	cache_limit = palloc_free_cnt (PAL_USER) / 4;
+	if (cache_limit == 0)
+		cache_limit = 1;
+	cache_ready = true;
+	page_cache_workerd = thread_create ("kworkerd", PRI_DEFAULT,
+			page_cache_kworkerd, NULL);
+	if (page_cache_workerd == TID_ERROR)
+		PANIC ("page cache: cannot start writeback worker");
+#endif
 }
 
 /* Initialize the page cache */
@@ -44,7 +130,563 @@ static void
 page_cache_destroy (struct page *page) {
 }
 
-/* Worker thread for page cache */
+#ifdef VM
+static uint64_t
+cache_page_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct cache_page *cp = hash_entry (e, struct cache_page, elem);
+	uint64_t key[2] = { (uint64_t) cp->inode, cp->index };
+
+	return hash_bytes (key, sizeof key);
+}
+
+static bool
+cache_page_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct cache_page *a = hash_entry (a_, struct cache_page, elem);
+	const struct cache_page *b = hash_entry (b_, struct cache_page, elem);
+
+	if (a->inode != b->inode)
+		return a->inode < b->inode;
+	return a->index < b->index;
+}
+
+/* Returns the number of bytes of INODE that page INDEX holds. */
+static size_t
+cache_valid_bytes (struct inode *inode, size_t index) {
+	off_t length = inode_length (inode);
+	off_t pos = (off_t) index * PGSIZE;
+
+	if (pos >= length)
+		return 0;
+	return length - pos < PGSIZE ? (size_t) (length - pos) : PGSIZE;
+}
+
+/* Writes CP back to its file. */
+static void
+cache_page_write (struct cache_page *cp) {
+	size_t bytes = cache_valid_bytes (cp->inode, cp->index);
+	struct iov_iter it;
+
+	if (bytes > 0) {
+		iov_iter_init_buf (&it, cp->kva, bytes);
+		inode_write_direct (cp->inode, &it, bytes, (off_t) cp->index * PGSIZE);
+	}
+}
+
+/* Returns the cached page INDEX of INODE, or NULL. */
+static struct cache_page *
+cache_lookup (struct inode *inode, size_t index) {
+	struct cache_page key;
+	struct hash_elem *e;
+
+	key.inode = inode;
+	key.index = index;
+	e = hash_find (&cache_pages, &key.elem);
+	return e != NULL ? hash_entry (e, struct cache_page, elem) : NULL;
+}
+
+/* Returns true, and clears the accessed bits, if CP was used since the
+ * last call.  Accesses through a MADV_SEQUENTIAL mapping do not count. */
+static bool
+cache_page_referenced (struct cache_page *cp) {
+	bool referenced = cp->referenced;
+	struct list_elem *e;
+
+	cp->referenced = false;
+	for (e = list_begin (&cp->mappers); e != list_end (&cp->mappers);
+			e = list_next (e)) {
+		struct page *page = list_entry (e, struct page, file.cache_elem);
+
+		if (vm_pte_accessed (page) && page->advice != MADV_SEQUENTIAL)
+			referenced = true;
+	}
+	return referenced;
+}
+
+/* Returns true if a page locked with mlock() maps CP. */
+static bool
+cache_page_locked (struct cache_page *cp) {
+	struct list_elem *e;
+
+	for (e = list_begin (&cp->mappers); e != list_end (&cp->mappers);
+			e = list_next (e))
+		if (list_entry (e, struct page, file.cache_elem)->locked)
+			return true;
+	return false;
+}
+
+/* Unmaps CP from every page that maps it, writes it back if WRITEBACK and
+ * it is dirty, and frees it.  Its data page is left to the caller. */
+static void
+cache_page_drop (struct cache_page *cp, bool writeback) {
+	bool dirty = cp->dirty;
+
+	ASSERT (cp->pin_cnt == 0);
+
+	while (!list_empty (&cp->mappers)) {
+		struct page *page = list_entry (list_pop_front (&cp->mappers),
+				struct page, file.cache_elem);
+
+		if (vm_clear_pte (page))
+			dirty = true;
+		page->file.cache = NULL;
+	}
+	if (dirty && writeback)
+		cache_page_write (cp);
+
+	hash_delete (&cache_pages, &cp->elem);
+	list_remove (&cp->lru_elem);
+	list_remove (&cp->inode_elem);
+	cache_cnt--;
+	free (cp);
+}
+
+/* Evicts a cache page, giving recently used pages a second chance, and
+ * returns its data page.  Returns NULL if two full sweeps find nothing to
+ * evict. */
+static void *
+cache_evict (void) {
+	size_t sweep = 2 * cache_cnt;
+
+	for (size_t i = 0; i < sweep && !list_empty (&cache_lru); i++) {
+		struct cache_page *cp = list_entry (list_pop_front (&cache_lru),
+				struct cache_page, lru_elem);
+		void *kva;
+
+		list_push_back (&cache_lru, &cp->lru_elem);
+		if (cp->pin_cnt > 0 || cache_page_locked (cp)
+				|| cache_page_referenced (cp))
+			continue;
+		kva = cp->kva;
+		cache_page_drop (cp, true);
+		return kva;
+	}
+	return NULL;
+}
+
+/* Returns a page for new cache data.  Unless SPECULATIVE, evicts a cache
+ * page or a frame if it has to; otherwise returns NULL instead. */
+static void *
+cache_alloc (bool speculative) {
+	void *kva = NULL;
+
+	if (cache_cnt >= cache_limit) {
+		if (speculative)
+			return NULL;
+		kva = cache_evict ();
+	}
+	if (kva == NULL)
+		kva = palloc_get_page (PAL_USER);
+	if (kva == NULL && !speculative)
+		kva = cache_evict ();
+	if (kva == NULL && !speculative)
+		kva = vm_get_kpage ();
+	return kva;
+}
+
+/* Drops a pin on CP.  Must be called with cache_lock held. */
+static void
+cache_unpin (struct cache_page *cp) {
+	ASSERT (cp->pin_cnt > 0);
+	if (--cp->pin_cnt == 0)
+		cond_broadcast (&cache_unpinned, &cache_lock);
+}
+
+/* Returns page INDEX of INODE, bringing it into the cache if it is not
+ * there yet.  Unless FILL, a new cache page is not read from the file,
+ * because the caller is about to overwrite all of it.  Returns NULL if
+ * memory is exhausted, or for a SPECULATIVE load that would need to evict
+ * something.  Must be called with cache_lock held, which is released
+ * while the page is read from disk, or while waiting for another thread
+ * to finish reading it. */
+static struct cache_page *
+cache_get (struct inode *inode, size_t index, bool fill, bool speculative) {
+	struct cache_page *cp = cache_lookup (inode, index);
+	size_t bytes;
+
+	if (cp != NULL) {
+		cp->referenced = true;
+		if (cp->loading) {
+			/* The pin keeps CP from being evicted once it is loaded,
+			 * before this thread runs again. */
+			cp->pin_cnt++;
+			while (cp->loading)
+				cond_wait (&cp->loaded, &cache_lock);
+			cache_unpin (cp);
+		}
+		return cp;
+	}
+
+	cp = malloc (sizeof *cp);
+	if (cp == NULL)
+		return NULL;
+	cp->kva = cache_alloc (speculative);
+	if (cp->kva == NULL) {
+		free (cp);
+		return NULL;
+	}
+	bytes = fill ? cache_valid_bytes (inode, index) : 0;
+	memset ((uint8_t *) cp->kva + bytes, 0, PGSIZE - bytes);
+
+	cp->inode = inode;
+	cp->index = index;
+	list_init (&cp->mappers);
+	cp->pin_cnt = 0;
+	cp->loading = bytes > 0;
+	cond_init (&cp->loaded);
+	cp->dirty = false;
+	cp->referenced = true;
+	hash_insert (&cache_pages, &cp->elem);
+	list_push_back (&cache_lru, &cp->lru_elem);
+	list_push_back (inode_cache_pages (inode), &cp->inode_elem);
+	cache_cnt++;
+
+	/* Read the data without cache_lock.  Meanwhile the pin keeps CP in
+	 * the cache, and LOADING makes lookups of it wait. */
+	if (cp->loading) {
+		struct iov_iter it;
+
+		cp->pin_cnt++;
+		lock_release (&cache_lock);
+		iov_iter_init_buf (&it, cp->kva, bytes);
+		inode_read_direct (inode, &it, bytes, (off_t) index * PGSIZE);
+		lock_acquire (&cache_lock);
+		cp->loading = false;
+		cond_broadcast (&cp->loaded, &cache_lock);
+		cache_unpin (cp);
+	}
+	return cp;
+}
+
+/* Reads SIZE bytes from INODE into the buffers of IT, starting at
+ * position OFFSET, through the cache.  Returns the number of bytes read,
+ * which is less than SIZE at end of file or if memory is exhausted. */
+off_t
+page_cache_read (struct inode *inode, struct iov_iter *it, off_t size,
+		off_t offset) {
+	off_t bytes_read = 0;
+
+	if (!cache_ready)
+		return inode_read_direct (inode, it, size, offset);
+
+	while (size > 0) {
+		/* Bytes left in inode, bytes left in page, lesser of the two. */
+		off_t inode_left = inode_length (inode) - offset;
+		int page_ofs = offset % PGSIZE;
+		int page_left = PGSIZE - page_ofs;
+		int min_left = inode_left < page_left ? inode_left : page_left;
+		int chunk_size = size < min_left ? size : min_left;
+		struct cache_page *cp;
+
+		if (chunk_size <= 0)
+			break;
+		lock_acquire (&cache_lock);
+		cp = cache_get (inode, offset / PGSIZE, true, false);
+		if (cp != NULL)
+			cp->pin_cnt++;
+		lock_release (&cache_lock);
+		if (cp == NULL)
+			break;
+
+		iov_iter_copy_to (it, (uint8_t *) cp->kva + page_ofs, chunk_size);
+		lock_acquire (&cache_lock);
+		cache_unpin (cp);
+		lock_release (&cache_lock);
+
+		size -= chunk_size;
+		offset += chunk_size;
+		bytes_read += chunk_size;
+	}
+	return bytes_read;
+}
+
+/* Writes SIZE bytes from the buffers of IT into INODE, starting at
+ * OFFSET, through the cache.  Returns the number of bytes written, which
+ * is less than SIZE at end of file or if memory is exhausted. */
+off_t
+page_cache_write (struct inode *inode, struct iov_iter *it, off_t size,
+		off_t offset) {
+	off_t bytes_written = 0;
+
+	if (!cache_ready)
+		return inode_write_direct (inode, it, size, offset);
+
+	while (size > 0) {
+		/* Bytes left in inode, bytes left in page, lesser of the two. */
+		off_t inode_left = inode_length (inode) - offset;
+		int page_ofs = offset % PGSIZE;
+		int page_left = PGSIZE - page_ofs;
+		int min_left = inode_left < page_left ? inode_left : page_left;
+		int chunk_size = size < min_left ? size : min_left;
+		struct cache_page *cp;
+
+		if (chunk_size <= 0)
+			break;
+		lock_acquire (&cache_lock);
+		cp = cache_get (inode, offset / PGSIZE, chunk_size < PGSIZE, false);
+		if (cp != NULL)
+			cp->pin_cnt++;
+		lock_release (&cache_lock);
+		if (cp == NULL)
+			break;
+
+		iov_iter_copy_from (it, (uint8_t *) cp->kva + page_ofs, chunk_size);
+		lock_acquire (&cache_lock);
+		cp->dirty = true;
+		cache_unpin (cp);
+		lock_release (&cache_lock);
+
+		size -= chunk_size;
+		offset += chunk_size;
+		bytes_written += chunk_size;
+	}
+	return bytes_written;
+}
+
+/* Copies SIZE bytes from SRC, starting at SRC_OFS, into DST, starting at
+ * DST_OFS, through the cache: each page of SRC is copied straight into
+ * the cache pages of DST, and pages of DST that are overwritten entirely
+ * are not read first.  Returns the number of bytes copied, which is less
+ * than SIZE at the end of either inode or if memory is exhausted. */
+off_t
+page_cache_copy (struct inode *dst, off_t dst_ofs, struct inode *src,
+		off_t src_ofs, off_t size) {
+	off_t bytes_copied = 0;
+
+	if (!cache_ready)
+		return inode_copy_direct (dst, dst_ofs, src, src_ofs, size);
+
+	while (size > 0) {
+		/* Bytes left in SRC, bytes left in its page, lesser of the two. */
+		off_t inode_left = inode_length (src) - src_ofs;
+		int page_ofs = src_ofs % PGSIZE;
+		int page_left = PGSIZE - page_ofs;
+		int min_left = inode_left < page_left ? inode_left : page_left;
+		int chunk_size = size < min_left ? size : min_left;
+		struct cache_page *cp;
+		struct iov_iter it;
+		off_t written;
+
+		if (chunk_size <= 0)
+			break;
+		lock_acquire (&cache_lock);
+		cp = cache_get (src, src_ofs / PGSIZE, true, false);
+		if (cp != NULL)
+			cp->pin_cnt++;
+		lock_release (&cache_lock);
+		if (cp == NULL)
+			break;
+
+		/* The pin keeps the source page from being evicted to make
+		 * room for the destination pages. */
+		iov_iter_init_buf (&it, (uint8_t *) cp->kva + page_ofs, chunk_size);
+		written = page_cache_write (dst, &it, chunk_size, dst_ofs);
+		lock_acquire (&cache_lock);
+		cache_unpin (cp);
+		lock_release (&cache_lock);
+
+		size -= written;
+		src_ofs += written;
+		dst_ofs += written;
+		bytes_copied += written;
+		if (written < chunk_size)
+			break;
+	}
+	return bytes_copied;
+}
+
+/* Returns true if the page of INODE that contains OFFSET is cached. */
+bool
+page_cache_contains (struct inode *inode, off_t offset) {
+	bool cached;
+
+	if (!cache_ready)
+		return false;
+	lock_acquire (&cache_lock);
+	cached = cache_lookup (inode, offset / PGSIZE) != NULL;
+	lock_release (&cache_lock);
+	return cached;
+}
+
+/* Drops the cached pages of INODE, whose last opener is closing it, after
+ * writing back the dirty ones if WRITEBACK. */
+void
+page_cache_release (struct inode *inode, bool writeback) {
+	struct list *pages = inode_cache_pages (inode);
+
+	if (!cache_ready)
+		return;
+	lock_acquire (&cache_lock);
+	while (!list_empty (pages)) {
+		struct cache_page *cp = list_entry (list_front (pages),
+				struct cache_page, inode_elem);
+		void *kva = cp->kva;
+
+		/* The worker may be writing CP back. */
+		if (cp->pin_cnt > 0) {
+			cond_wait (&cache_unpinned, &cache_lock);
+			continue;
+		}
+		ASSERT (list_empty (&cp->mappers));
+		cache_page_drop (cp, writeback);
+		palloc_free_page (kva);
+	}
+	lock_release (&cache_lock);
+}
+
+/* Orders cache pages for writeback: by inode, then by index. */
+static int
+writeback_cmp (const void *a_, const void *b_) {
+	const struct cache_page *a = *(struct cache_page * const *) a_;
+	const struct cache_page *b = *(struct cache_page * const *) b_;
+	disk_sector_t ia = inode_get_inumber (a->inode);
+	disk_sector_t ib = inode_get_inumber (b->inode);
+
+	if (ia != ib)
+		return ia < ib ? -1 : 1;
+	return a->index < b->index ? -1 : a->index > b->index;
+}
+
+/* Pins up to CNT dirty cache pages, marks them clean and stores them in
+ * PAGES for writeback.  A page written to after this call is dirty again,
+ * so no modification is lost.  Returns the number of pages stored. */
+static size_t
+cache_pin_dirty (struct cache_page **pages, size_t cnt) {
+	struct list_elem *e;
+	size_t n = 0;
+
+	lock_acquire (&cache_lock);
+	for (e = list_begin (&cache_lru); e != list_end (&cache_lru) && n < cnt;
+			e = list_next (e)) {
+		struct cache_page *cp = list_entry (e, struct cache_page, lru_elem);
+		bool dirty = cp->dirty;
+		struct list_elem *m;
+
+		for (m = list_begin (&cp->mappers); m != list_end (&cp->mappers);
+				m = list_next (m))
+			if (vm_pte_dirty (list_entry (m, struct page, file.cache_elem)))
+				dirty = true;
+		if (!dirty)
+			continue;
+		cp->dirty = false;
+		cp->pin_cnt++;
+		pages[n++] = cp;
+	}
+	lock_release (&cache_lock);
+	return n;
+}
+
+/* Writes back every dirty cache page. */
+void
+page_cache_flush (void) {
+	static struct cache_page *batch[WRITEBACK_BATCH];
+	size_t cnt;
+
+	if (!cache_ready)
+		return;
+	do {
+		cnt = cache_pin_dirty (batch, WRITEBACK_BATCH);
+		qsort (batch, cnt, sizeof *batch, writeback_cmp);
+		for (size_t i = 0; i < cnt; i++)
+			cache_page_write (batch[i]);
+
+		lock_acquire (&cache_lock);
+		for (size_t i = 0; i < cnt; i++)
+			cache_unpin (batch[i]);
+		lock_release (&cache_lock);
+	} while (cnt == WRITEBACK_BATCH);
+}
+
+/* Evicts a cache page to relieve memory pressure.  Returns true if a page
+ * was freed.  Gives up at once if the cache is busy, so that it may be
+ * called from any allocation path. */
+bool
+page_cache_shrink (void) {
+	void *kva;
+
+	if (!cache_ready || lock_held_by_current_thread (&cache_lock)
+			|| !lock_try_acquire (&cache_lock))
+		return false;
+	kva = cache_evict ();
+	lock_release (&cache_lock);
+	if (kva == NULL)
+		return false;
+	palloc_free_page (kva);
+	return true;
+}
+
+/* Maps the cache page that holds the contents of PAGE, a file backed
+ * page, at PAGE in its owner's page table, bringing it into the cache
+ * first if needed.  A SPECULATIVE mapping gives up rather than evict
+ * anything. */
+bool
+page_cache_map (struct page *page, bool speculative) {
+	struct file_page *file_page = &page->file;
+	struct cache_page *cp;
+	bool mapped = false;
+
+	lock_acquire (&cache_lock);
+	cp = file_page->cache;
+	if (cp == NULL)
+		cp = cache_get (file_get_inode (file_page->file),
+				file_page->offset / PGSIZE, true, speculative);
+	if (cp != NULL)
+		mapped = vm_set_pte (page, cp->kva);
+	if (mapped && file_page->cache == NULL) {
+		file_page->cache = cp;
+		list_push_back (&cp->mappers, &file_page->cache_elem);
+	}
+	lock_release (&cache_lock);
+	return mapped;
+}
+
+/* Unmaps PAGE from its cache page, if it is mapped, keeping a store
+ * through PAGE as a dirty cache page. */
+void
+page_cache_unmap (struct page *page) {
+	struct file_page *file_page = &page->file;
+	struct cache_page *cp;
+
+	lock_acquire (&cache_lock);
+	cp = file_page->cache;
+	if (cp != NULL) {
+		if (vm_clear_pte (page))
+			cp->dirty = true;
+		list_remove (&file_page->cache_elem);
+		file_page->cache = NULL;
+	}
+	lock_release (&cache_lock);
+}
+
+/* Pins the cache page mapped at PAGE, so that it is not evicted while a
+ * system call accesses it.  Returns false if PAGE is not mapped. */
+bool
+page_cache_pin (struct page *page) {
+	struct cache_page *cp;
+
+	lock_acquire (&cache_lock);
+	cp = page->file.cache;
+	if (cp != NULL)
+		cp->pin_cnt++;
+	lock_release (&cache_lock);
+	return cp != NULL;
+}
+
+/* Unpins the cache page pinned with page_cache_pin (PAGE). */
+void
+page_cache_unpin (struct page *page) {
+	lock_acquire (&cache_lock);
+	ASSERT (page->file.cache != NULL);
+	cache_unpin (page->file.cache);
+	lock_release (&cache_lock);
+}
+
+/* Worker thread for page cache: writes dirty pages back periodically. */
 static void
-page_cache_kworkerd (void *aux) {
+page_cache_kworkerd (void *aux UNUSED) {
+	for (;;) {
+		timer_sleep (WRITEBACK_INTERVAL);
+		page_cache_flush ();
+	}
 }
+#endif
@@ -0,0 +1,241 @@
+/* pipe.c: Pipes between processes.
+ *
+ * A pipe keeps the bytes that have been written to it but not read yet
+ * in a ring of pages.  The ring is filled and drained a page at a time,
+ * directly from and into the buffers of the system call, so data is
+ * copied once on each side.  Pages are allocated only when the writer
+ * reaches them, and a drained page is kept for the writer to reuse. */
+
+#include "filesys/pipe.h"
+#include <debug.h>
+#include <iov.h>
+#include <poll.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "threads/wait.h"
+
+/* Number of pages in the ring of a pipe. */
+#define PIPE_PAGES 16
+
+/* Bytes that a pipe holds. */
+#define PIPE_SIZE (PIPE_PAGES * PGSIZE)
+
+/* Writes of up to this many bytes are not interleaved with other
+ * writes to the same pipe. */
+#define PIPE_ATOMIC PGSIZE
+
+struct pipe {
+	struct lock lock;           /* Protects all the members below. */
+	struct condition readable;  /* Data arrived or the last writer left. */
+	struct condition writable;  /* Room freed or the last reader left. */
+	struct wait_queue pollers;  /* Threads in poll() on either end. */
+	void *pages[PIPE_PAGES];    /* Ring; null where not allocated. */
+	void *spare;                /* Drained page kept for reuse. */
+	uint64_t head;              /* Bytes written so far. */
+	uint64_t tail;              /* Bytes read so far. */
+	int readers;                /* Open read ends. */
+	int writers;                /* Open write ends. */
+};
+
+/* Creates a pipe and opens its two ends as *READ_END and *WRITE_END.
+ * Returns false if memory runs out. */
+bool
+pipe_create (struct file **read_end, struct file **write_end) {
+	struct pipe *pipe = calloc (1, sizeof *pipe);
+
+	if (pipe == NULL)
+		return false;
+	lock_init (&pipe->lock);
+	cond_init (&pipe->readable);
+	cond_init (&pipe->writable);
+	wait_queue_init (&pipe->pollers);
+	pipe->readers = pipe->writers = 1;
+
+	/* Each end closes its reference to PIPE if it cannot be opened, so
+	 * PIPE is freed once neither is left. */
+	*read_end = file_open_pipe (pipe, false);
+	*write_end = file_open_pipe (pipe, true);
+	if (*read_end == NULL || *write_end == NULL) {
+		file_close (*read_end);
+		file_close (*write_end);
+		return false;
+	}
+	return true;
+}
+
+/* Takes another reference to the write end of PIPE if WRITER is true,
+ * to its read end otherwise, and returns PIPE. */
+struct pipe *
+pipe_reopen (struct pipe *pipe, bool writer) {
+	lock_acquire (&pipe->lock);
+	if (writer)
+		pipe->writers++;
+	else
+		pipe->readers++;
+	lock_release (&pipe->lock);
+	return pipe;
+}
+
+/* Drops a reference to the write end of PIPE if WRITER is true, to its
+ * read end otherwise.  Frees PIPE along with its last reference. */
+void
+pipe_close (struct pipe *pipe, bool writer) {
+	bool last;
+
+	lock_acquire (&pipe->lock);
+	if (writer) {
+		ASSERT (pipe->writers > 0);
+		if (--pipe->writers == 0) {
+			cond_broadcast (&pipe->readable, &pipe->lock);
+			wait_queue_wake (&pipe->pollers);
+		}
+	} else {
+		ASSERT (pipe->readers > 0);
+		if (--pipe->readers == 0) {
+			cond_broadcast (&pipe->writable, &pipe->lock);
+			wait_queue_wake (&pipe->pollers);
+		}
+	}
+	last = pipe->readers == 0 && pipe->writers == 0;
+	lock_release (&pipe->lock);
+
+	if (last) {
+		for (int i = 0; i < PIPE_PAGES; i++)
+			if (pipe->pages[i] != NULL)
+				palloc_free_page (pipe->pages[i]);
+		if (pipe->spare != NULL)
+			palloc_free_page (pipe->spare);
+		free (pipe);
+	}
+}
+
+/* Returns the ring page that holds byte POS of PIPE, allocating it if
+ * there is none yet.  Returns a null pointer if memory runs out. */
+static void *
+ring_page (struct pipe *pipe, uint64_t pos) {
+	void **page = &pipe->pages[pos / PGSIZE % PIPE_PAGES];
+
+	if (*page == NULL) {
+		if (pipe->spare != NULL) {
+			*page = pipe->spare;
+			pipe->spare = NULL;
+		} else
+			*page = palloc_get_page (0);
+	}
+	return *page;
+}
+
+/* Reads up to SIZE bytes from PIPE into the buffers of IT.  Waits until
+ * at least one byte has been written, unless no write end is left open.
+ * Returns the number of bytes read, which is 0 at end of file. */
+off_t
+pipe_read (struct pipe *pipe, struct iov_iter *it, off_t size) {
+	off_t done = 0;
+
+	if (size <= 0)
+		return 0;
+
+	lock_acquire (&pipe->lock);
+	while (pipe->head == pipe->tail && pipe->writers > 0)
+		cond_wait (&pipe->readable, &pipe->lock);
+
+	while (done < size && pipe->tail < pipe->head) {
+		uint64_t avail = pipe->head - pipe->tail;
+		size_t ofs = pipe->tail % PGSIZE;
+		size_t n = PGSIZE - ofs;
+		void **page = &pipe->pages[pipe->tail / PGSIZE % PIPE_PAGES];
+
+		if (n > avail)
+			n = avail;
+		if (n > (size_t) (size - done))
+			n = size - done;
+		iov_iter_copy_to (it, (uint8_t *) *page + ofs, n);
+		pipe->tail += n;
+		done += n;
+
+		/* The writer is past a page that has been read to its end. */
+		if (pipe->tail % PGSIZE == 0) {
+			if (pipe->spare == NULL)
+				pipe->spare = *page;
+			else
+				palloc_free_page (*page);
+			*page = NULL;
+		}
+	}
+	if (done > 0) {
+		cond_broadcast (&pipe->writable, &pipe->lock);
+		wait_queue_wake (&pipe->pollers);
+	}
+	lock_release (&pipe->lock);
+	return done;
+}
+
+/* Writes SIZE bytes from the buffers of IT into PIPE, waiting for room
+ * as needed.  Returns the number of bytes written, which is less than
+ * SIZE only if the last read end is closed or memory runs out midway,
+ * or -1 if nothing could be written. */
+off_t
+pipe_write (struct pipe *pipe, struct iov_iter *it, off_t size) {
+	off_t done = 0;
+
+	lock_acquire (&pipe->lock);
+	while (done < size) {
+		uint64_t room = PIPE_SIZE - (pipe->head - pipe->tail);
+		size_t ofs = pipe->head % PGSIZE;
+		size_t n = PGSIZE - ofs;
+		void *page;
+
+		if (pipe->readers == 0)
+			break;
+		/* A small write waits until it fits as a whole. */
+		if (room == 0 || (size <= PIPE_ATOMIC && room < (uint64_t) size)) {
+			cond_wait (&pipe->writable, &pipe->lock);
+			continue;
+		}
+		page = ring_page (pipe, pipe->head);
+		if (page == NULL)
+			break;
+
+		if (n > room)
+			n = room;
+		if (n > (size_t) (size - done))
+			n = size - done;
+		iov_iter_copy_from (it, (uint8_t *) page + ofs, n);
+		pipe->head += n;
+		done += n;
+		cond_broadcast (&pipe->readable, &pipe->lock);
+	}
+	if (done > 0)
+		wait_queue_wake (&pipe->pollers);
+	lock_release (&pipe->lock);
+	return done > 0 || size == 0 ? done : -1;
+}
+
+/* Returns the poll() events that hold for the write end of PIPE if
+ * WRITER is true, for its read end otherwise.  The write end counts
+ * as writable once a write of PIPE_ATOMIC bytes would not wait.  Puts
+ * PT, if not null, on the queue of threads to wake when they may
+ * change. */
+int
+pipe_poll (struct pipe *pipe, bool writer, struct poll_table *pt) {
+	int events = 0;
+
+	lock_acquire (&pipe->lock);
+	poll_table_add (pt, &pipe->pollers);
+	if (writer) {
+		if (pipe->readers == 0)
+			events |= POLLERR;
+		else if (PIPE_SIZE - (pipe->head - pipe->tail) >= PIPE_ATOMIC)
+			events |= POLLOUT;
+	} else {
+		if (pipe->tail < pipe->head)
+			events |= POLLIN;
+		if (pipe->writers == 0)
+			events |= POLLHUP;
+	}
+	lock_release (&pipe->lock);
+	return events;
+}
@@ -4,9 +4,12 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+struct poll_table;
+
 void input_init (void);
 void input_putc (uint8_t);
 uint8_t input_getc (void);
+bool input_poll (struct poll_table *);
 bool input_full (void);
 
 #endif /* devices/input.h */
@@ -1,22 +1,40 @@
 #ifndef FILESYS_FILE_H
 #define FILESYS_FILE_H
 
+#include <stdbool.h>
 #include "filesys/off_t.h"
 
 struct inode;
+struct iov_iter;
+struct pipe;
 
 /* Opening and closing files. */
 struct file *file_open (struct inode *);
+struct file *file_open_pipe (struct pipe *, bool writer);
+struct file *file_open_console (bool writer);
 struct file *file_reopen (struct file *);
 struct file *file_duplicate (struct file *file);
+struct file *file_duplicate_once (struct file *);
+void file_forget_duplicate (struct file *);
+struct file *file_share (struct file *);
+bool file_is_shared (const struct file *);
 void file_close (struct file *);
 struct inode *file_get_inode (struct file *);
+struct pipe *file_get_pipe (struct file *, bool writer);
+bool file_is_console (const struct file *, bool writer);
 
 /* Reading and writing. */
 off_t file_read (struct file *, void *, off_t);
 off_t file_read_at (struct file *, void *, off_t size, off_t start);
 off_t file_write (struct file *, const void *, off_t);
 off_t file_write_at (struct file *, const void *, off_t size, off_t start);
+off_t file_read_iter (struct file *, struct iov_iter *, off_t size);
+off_t file_read_iter_at (struct file *, struct iov_iter *, off_t size,
+		off_t start);
+off_t file_write_iter (struct file *, struct iov_iter *, off_t size);
+off_t file_write_iter_at (struct file *, struct iov_iter *, off_t size,
+		off_t start);
+off_t file_copy_range (struct file *out, struct file *in, off_t size);
 
 /* Preventing writes. */
 void file_deny_write (struct file *);
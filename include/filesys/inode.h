@@ -6,6 +6,9 @@
 #include "devices/disk.h"
 
 struct bitmap;
+struct list;
+struct iov_iter;
+struct exec_image;
 
 void inode_init (void);
 bool inode_create (disk_sector_t, off_t);
@@ -16,8 +19,26 @@ void inode_close (struct inode *);
 void inode_remove (struct inode *);
 off_t inode_read_at (struct inode *, void *, off_t size, off_t offset);
 off_t inode_write_at (struct inode *, const void *, off_t size, off_t offset);
+off_t inode_read_iter (struct inode *, struct iov_iter *, off_t size,
+		off_t offset);
+off_t inode_write_iter (struct inode *, struct iov_iter *, off_t size,
+		off_t offset);
+off_t inode_read_direct (struct inode *, struct iov_iter *, off_t size,
+		off_t offset);
+off_t inode_write_direct (struct inode *, struct iov_iter *, off_t size,
+		off_t offset);
+off_t inode_copy_at (struct inode *dst, off_t dst_ofs, struct inode *src,
+		off_t src_ofs, off_t size);
+off_t inode_copy_direct (struct inode *dst, off_t dst_ofs,
+		struct inode *src, off_t src_ofs, off_t size);
 void inode_deny_write (struct inode *);
 void inode_allow_write (struct inode *);
 off_t inode_length (const struct inode *);
+struct exec_image *inode_get_exec_image (const struct inode *);
+bool inode_set_exec_image (struct inode *, struct exec_image *);
+void inode_map_writable (struct inode *);
+#ifdef VM
+struct list *inode_cache_pages (struct inode *);
+#endif
 
 #endif /* filesys/inode.h */
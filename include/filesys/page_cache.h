@@ -1,12 +1,33 @@
 #ifndef FILESYS_PAGE_CACHE_H
 #define FILESYS_PAGE_CACHE_H
-#include "vm/vm.h"
+#include <stdbool.h>
+#include "filesys/off_t.h"
 
 struct page;
+struct inode;
+struct iov_iter;
 enum vm_type;
 
 struct page_cache {};
 
-void page_cache_init (void);
+void pagecache_init (void);
 bool page_cache_initializer (struct page *page, enum vm_type type, void *kva);
+
+#ifdef VM
+off_t page_cache_read (struct inode *, struct iov_iter *, off_t size,
+		off_t offset);
+off_t page_cache_write (struct inode *, struct iov_iter *, off_t size,
+		off_t offset);
+off_t page_cache_copy (struct inode *dst, off_t dst_ofs, struct inode *src,
+		off_t src_ofs, off_t size);
+bool page_cache_contains (struct inode *, off_t offset);
+void page_cache_release (struct inode *, bool writeback);
+void page_cache_flush (void);
+bool page_cache_shrink (void);
+
+bool page_cache_map (struct page *page, bool speculative);
+void page_cache_unmap (struct page *page);
+bool page_cache_pin (struct page *page);
+void page_cache_unpin (struct page *page);
+#endif
 #endif
@@ -0,0 +1,19 @@
+#ifndef FILESYS_PIPE_H
+#define FILESYS_PIPE_H
+
+#include <stdbool.h>
+#include "filesys/off_t.h"
+
+struct file;
+struct pipe;
+struct iov_iter;
+struct poll_table;
+
+bool pipe_create (struct file **read_end, struct file **write_end);
+struct pipe *pipe_reopen (struct pipe *, bool writer);
+void pipe_close (struct pipe *, bool writer);
+off_t pipe_read (struct pipe *, struct iov_iter *, off_t size);
+off_t pipe_write (struct pipe *, struct iov_iter *, off_t size);
+int pipe_poll (struct pipe *, bool writer, struct poll_table *);
+
+#endif /* filesys/pipe.h */
@@ -0,0 +1,15 @@
+#ifndef __LIB_IOVEC_H
+#define __LIB_IOVEC_H
+
+#include <stddef.h>
+
+/* A buffer for the readv() and writev() system calls. */
+struct iovec {
+	void *iov_base;             /* Start of the buffer. */
+	size_t iov_len;             /* Size of the buffer in bytes. */
+};
+
+/* Most buffers that one readv() or writev() call accepts. */
+#define IOV_MAX 1024
+
+#endif /* lib/iovec.h */
@@ -0,0 +1,23 @@
+#ifndef __LIB_KERNEL_IOV_H
+#define __LIB_KERNEL_IOV_H
+
+#include <iovec.h>
+#include <stddef.h>
+
+/* A position in an array of iovecs, for copying a stream of bytes to or
+   from the buffers they describe.  Zero-length buffers are skipped. */
+struct iov_iter {
+	const struct iovec *iov;    /* Current buffer. */
+	size_t cnt;                 /* Buffers left, counting the current. */
+	size_t ofs;                 /* Offset into the current buffer. */
+	struct iovec single;        /* Buffer of iov_iter_init_buf(). */
+};
+
+void iov_iter_init (struct iov_iter *, const struct iovec *, size_t cnt);
+void iov_iter_init_buf (struct iov_iter *, void *, size_t size);
+void *iov_iter_contig (const struct iov_iter *, size_t size);
+void iov_iter_advance (struct iov_iter *, size_t size);
+size_t iov_iter_copy_to (struct iov_iter *, const void *, size_t size);
+size_t iov_iter_copy_from (struct iov_iter *, void *, size_t size);
+
+#endif /* lib/kernel/iov.h */
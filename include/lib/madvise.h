@@ -0,0 +1,13 @@
+#ifndef __LIB_MADVISE_H
+#define __LIB_MADVISE_H
+
+/* Access pattern advice for the madvise() system call. */
+#define MADV_NORMAL 0       /* No special treatment. */
+#define MADV_RANDOM 1       /* No fault-around and no readahead. */
+#define MADV_SEQUENTIAL 2   /* Read ahead at full window; reclaim pages
+                               as soon as the scan has passed them. */
+#define MADV_WILLNEED 3     /* Start bringing the pages in now. */
+#define MADV_DONTNEED 4     /* Drop the pages.  Anonymous pages read back
+                               as zeros, file pages from the file. */
+
+#endif /* lib/madvise.h */
@@ -0,0 +1,19 @@
+#ifndef __LIB_POLL_H
+#define __LIB_POLL_H
+
+/* A descriptor for the poll() system call to watch. */
+struct pollfd {
+	int fd;                     /* Descriptor, ignored if negative. */
+	short events;               /* Events to watch for. */
+	short revents;              /* Events that happened. */
+};
+
+/* Events.  POLLERR, POLLHUP and POLLNVAL are always reported, whether
+   or not they are in EVENTS. */
+#define POLLIN   0x001          /* Can read without waiting. */
+#define POLLOUT  0x004          /* Can write without waiting. */
+#define POLLERR  0x008          /* Pipe has no read end left. */
+#define POLLHUP  0x010          /* Pipe has no write end left. */
+#define POLLNVAL 0x020          /* Descriptor is not open. */
+
+#endif /* lib/poll.h */
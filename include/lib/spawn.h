@@ -0,0 +1,23 @@
+#ifndef __LIB_SPAWN_H
+#define __LIB_SPAWN_H
+
+/* File descriptor actions for the spawn() system call.  The child
+   starts with a copy of every descriptor of the parent, at the same
+   numbers, and then applies the actions in order.  A list of actions
+   ends with one of type SPAWN_END. */
+enum spawn_action_type {
+	SPAWN_END,                  /* End of the list. */
+	SPAWN_DUP2,                 /* Make NEWFD a copy of FD. */
+	SPAWN_CLOSE,                /* Close FD. */
+};
+
+struct spawn_fd_action {
+	int type;                   /* An enum spawn_action_type. */
+	int fd;                     /* Descriptor acted on. */
+	int newfd;                  /* Target of SPAWN_DUP2. */
+};
+
+/* Most actions that one spawn() call accepts. */
+#define SPAWN_MAX_ACTIONS 16
+
+#endif /* lib/spawn.h */
@@ -36,6 +36,21 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Extensions. */
+	SYS_MMAP_SHARED,            /* Map shared memory. */
+	SYS_VMSTAT,                 /* Read virtual memory statistics. */
+	SYS_MADVISE,                /* Advise on memory access patterns. */
+	SYS_MLOCK,                  /* Lock pages in memory. */
+	SYS_MUNLOCK,                /* Unlock pages. */
+	SYS_READV,                  /* Read into several buffers. */
+	SYS_WRITEV,                 /* Write from several buffers. */
+	SYS_PREAD,                  /* Read at a given file position. */
+	SYS_PWRITE,                 /* Write at a given file position. */
+	SYS_COPY_FILE_RANGE,        /* Copy between files in the kernel. */
+	SYS_SPAWN,                  /* Start a new process from a file. */
+	SYS_PIPE,                   /* Create a pipe. */
+	SYS_POLL,                   /* Wait for descriptors to be ready. */
 };
 
 #endif /* lib/syscall-nr.h */
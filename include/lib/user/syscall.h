@@ -4,6 +4,11 @@
 #include <stdbool.h>
 #include <debug.h>
 #include <stddef.h>
+#include <iovec.h>
+#include <madvise.h>
+#include <poll.h>
+#include <spawn.h>
+#include <vmstat.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -37,10 +42,25 @@ unsigned tell (int fd);
 void close (int fd);
 
 int dup2(int oldfd, int newfd);
+int readv (int fd, const struct iovec *iov, int iovcnt);
+int writev (int fd, const struct iovec *iov, int iovcnt);
+int pread (int fd, void *buffer, unsigned length, off_t offset);
+int pwrite (int fd, const void *buffer, unsigned length, off_t offset);
+int copy_file_range (int in_fd, int out_fd, unsigned length);
+pid_t spawn (const char *file, const char *argv[],
+		const struct spawn_fd_action *actions);
+int pipe (int fds[2]);
+int poll (struct pollfd *fds, unsigned nfds, int timeout);
 
 /* Project 3 and optionally project 4. */
 void *mmap (void *addr, size_t length, int writable, int fd, off_t offset);
 void munmap (void *addr);
+void *mmap_shared (void *addr, size_t length, int writable, int fd,
+		off_t offset);
+bool vmstat (struct vmstat *);
+bool madvise (void *addr, size_t length, int advice);
+bool mlock (const void *addr, size_t length);
+bool munlock (const void *addr, size_t length);
 
 /* Project 4 only. */
 bool chdir (const char *dir);
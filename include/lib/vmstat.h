@@ -0,0 +1,37 @@
+#ifndef __LIB_VMSTAT_H
+#define __LIB_VMSTAT_H
+
+#include <stdint.h>
+
+/* Virtual memory event counters, as returned by the vmstat() system
+   call. */
+enum vmstat_event {
+	VMSTAT_FAULT_MINOR,         /* Faults resolved without disk I/O. */
+	VMSTAT_FAULT_MAJOR,         /* Faults that read a file or swap. */
+	VMSTAT_FAULT_ANON,          /* Faults on anonymous pages. */
+	VMSTAT_FAULT_FILE,          /* Faults on file backed pages. */
+	VMSTAT_FAULT_UNINIT,        /* First faults on lazily loaded pages. */
+	VMSTAT_FAULT_STACK,         /* Faults that grew the stack. */
+	VMSTAT_FAULT_COW,           /* Writes that unshared a page. */
+	VMSTAT_FAULT_WP,            /* Faults on write protected pages. */
+	VMSTAT_EVICT,               /* Frames evicted. */
+	VMSTAT_SWAP_IN,             /* Anonymous pages swapped in. */
+	VMSTAT_SWAP_OUT,            /* Anonymous pages swapped out. */
+	VMSTAT_THP_FAULT,           /* Faults that mapped a huge page. */
+	VMSTAT_THP_FALLBACK,        /* Huge page faults that got a single page
+	                               for lack of memory. */
+	VMSTAT_EVENT_CNT
+};
+
+/* Number of buckets in the fault latency histogram. */
+#define VMSTAT_LATENCY_BUCKETS 64
+
+struct vmstat {
+	uint64_t events[VMSTAT_EVENT_CNT];
+
+	/* Fault handling time: bucket I counts the faults that took
+	   between 2**I and 2**(I+1) - 1 TSC cycles. */
+	uint64_t fault_latency[VMSTAT_LATENCY_BUCKETS];
+};
+
+#endif /* lib/vmstat.h */
@@ -5,6 +5,9 @@
 #include <list.h>
 #include <stdint.h>
 #include "threads/interrupt.h"
+#ifdef USERPROG
+#include "userprog/fdtable.h"
+#endif
 #ifdef VM
 #include "vm/vm.h"
 #endif
@@ -98,10 +101,25 @@ struct thread {
 #ifdef USERPROG
 	/* Owned by userprog/process.c. */
 	uint64_t *pml4;                     /* Page map level 4 */
+	int exit_status;                    /* Status reported to the parent. */
+	struct child *child;                /* Record shared with the parent,
+	                                       null if not a user process. */
+	struct list children;               /* Records of the children. */
+	struct fd_table fds;                /* File descriptor table. */
+	struct file *exec_file;             /* Running executable. */
 #endif
 #ifdef VM
 	/* Table for whole virtual memory owned by thread. */
 	struct supplemental_page_table spt;
+	uintptr_t user_rsp;                 /* User rsp on syscall entry. */
+
+	/* Memory accounting, protected by the frame table lock (vm/vm.c). */
+	size_t rss;                         /* Resident pages. */
+	size_t rss_limit;                   /* Resident page limit, 0 if none. */
+	size_t wss;                         /* Working set estimate, in pages. */
+	size_t ws_count;                    /* Pages accessed in this sample. */
+	unsigned ws_epoch;                  /* Sample that WS_COUNT belongs to. */
+	size_t locked_cnt;                  /* Pages locked with mlock(). */
 #endif
 
 	/* Owned by thread.c. */
@@ -120,6 +138,7 @@ void thread_start (void);
 void thread_tick (void);
 void thread_sleep (int64_t ticks);
 void thread_awake (int64_t ticks);
+void thread_wake (struct thread *);
 void thread_print_stats (void);
 
 typedef void thread_func (void *aux);
@@ -0,0 +1,41 @@
+#ifndef THREADS_WAIT_H
+#define THREADS_WAIT_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Threads waiting in poll() for something to happen to an object.
+ * Unlike a condition variable it can be woken from an interrupt
+ * handler, and a thread can wait on many queues at once. */
+struct wait_queue {
+	struct list waiters;        /* List of struct poll_entry. */
+};
+
+/* A wait queue that a poll table is on. */
+struct poll_entry {
+	struct list_elem elem;      /* Element in QUEUE's list. */
+	struct poll_table *table;   /* Table that this entry belongs to. */
+	struct wait_queue *queue;   /* Queue that this entry is on. */
+};
+
+/* The wait queues that one call to poll() waits on. */
+struct poll_table {
+	struct thread *thread;      /* Polling thread. */
+	struct poll_entry *entries; /* Room for CAPACITY entries. */
+	size_t cnt;                 /* Entries in use. */
+	size_t capacity;            /* Size of ENTRIES. */
+	bool triggered;             /* A queue was woken since the last wait. */
+	bool blocked;               /* Thread is waiting in poll_table_wait(). */
+};
+
+void wait_queue_init (struct wait_queue *);
+void wait_queue_wake (struct wait_queue *);
+
+void poll_table_init (struct poll_table *, struct poll_entry *, size_t);
+void poll_table_add (struct poll_table *, struct wait_queue *);
+bool poll_table_wait (struct poll_table *, int64_t wake_time);
+void poll_table_destroy (struct poll_table *);
+
+#endif /* threads/wait.h */
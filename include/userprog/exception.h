@@ -1,11 +1,31 @@
 #ifndef USERPROG_EXCEPTION_H
 #define USERPROG_EXCEPTION_H
 
+#include <stdint.h>
+
 /* Page fault error code bits that describe the cause of the exception.  */
 #define PF_P 0x1    /* 0: not-present page. 1: access rights violation. */
 #define PF_W 0x2    /* 0: read, 1: write. */
 #define PF_U 0x4    /* 0: kernel, 1: user process. */
 
+/* An exception table entry.  A page fault raised by the kernel
+   instruction at INSN does not bring the kernel down: execution
+   resumes at FIXUP instead, which reports the failure to the
+   caller.  This is how the kernel accesses user memory without
+   checking beforehand that it is mapped. */
+struct exception_entry {
+	uint64_t insn;              /* Address of the faulting instruction. */
+	uint64_t fixup;             /* Address to resume at. */
+};
+
+/* Inline assembly text that adds an exception table entry for the
+   instruction at label INSN, with its fixup code at label FIXUP. */
+#define EXCEPTION_TABLE_ENTRY(INSN, FIXUP) \
+	".pushsection __ex_table, \"a\"\n\t" \
+	".balign 8\n\t" \
+	".quad " INSN ", " FIXUP "\n\t" \
+	".popsection\n\t"
+
 void exception_init (void);
 void exception_print_stats (void);
 
@@ -0,0 +1,33 @@
+#ifndef USERPROG_FDTABLE_H
+#define USERPROG_FDTABLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct file;
+
+/* Most file descriptors that a process can have, one bit of the
+ * summary word for each word of the map. */
+#define FD_MAX (64 * 64)
+
+/* The file descriptor table of a process.  It starts small and grows by
+ * doubling.  A bitmap of the descriptors in use, with a summary word
+ * that marks its full words, finds the lowest free descriptor with two
+ * bit scans.  Descriptors 0 and 1 start out as the console, but are
+ * ordinary entries that can be closed or replaced. */
+struct fd_table {
+	struct file **files;        /* FILES[FD], null if FD is not open. */
+	uint64_t *map;              /* Bit FD set if FD is in use. */
+	uint64_t summary;           /* Bit I set if word I of MAP is full. */
+	int size;                   /* Descriptors that FILES has room for. */
+};
+
+bool fd_table_init (struct fd_table *);
+bool fd_table_copy (struct fd_table *dst, const struct fd_table *src);
+void fd_table_destroy (struct fd_table *);
+struct file *fd_table_get (const struct fd_table *, int fd);
+int fd_table_install (struct fd_table *, struct file *);
+int fd_table_dup2 (struct fd_table *, int oldfd, int newfd);
+struct file *fd_table_remove (struct fd_table *, int fd);
+
+#endif /* userprog/fdtable.h */
@@ -1,13 +1,39 @@
 #ifndef VM_ANON_H
 #define VM_ANON_H
 #include "vm/vm.h"
+#include "vm/zswap.h"
 struct page;
 enum vm_type;
 
+/* Where the contents of an anonymous page are while it is not resident. */
+enum anon_store {
+	ANON_RESIDENT,               /* Nowhere, the page is in a frame. */
+	ANON_ZERO,                   /* All zero, nothing stored. */
+	ANON_ZSWAP,                  /* Compressed in the zswap arena. */
+	ANON_SWAP,                   /* In a slot of the swap disk. */
+	ANON_KSM                     /* Merged, mapped read-only to a ksm_node. */
+};
+
+/* A page merged by the KSM scanner (vm/vm.c): contents shared read-only
+ * by all the anonymous pages that had them. */
+struct ksm_node {
+	struct hash_elem elem;       /* Element in the KSM stable table. */
+	uint64_t checksum;           /* Checksum of the contents. */
+	void *kva;                   /* The contents. */
+	int ref_cnt;                 /* Pages mapping the node. */
+};
+
 struct anon_page {
+	enum anon_store store;
+	union {
+		size_t swap_slot;            /* ANON_SWAP: swap slot. */
+		struct zswap_entry zswap;    /* ANON_ZSWAP: compressed copy. */
+		struct ksm_node *ksm;        /* ANON_KSM: merged page. */
+	};
 };
 
 void vm_anon_init (void);
 bool anon_initializer (struct page *page, enum vm_type type, void *kva);
+void anon_discard (struct page *page);
 
 #endif
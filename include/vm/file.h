@@ -5,13 +5,65 @@
 
 struct page;
 enum vm_type;
+struct supplemental_page_table;
+struct cache_page;
 
+/* A region created by one call to do_mmap, and the access pattern its
+ * page faults have shown so far. */
+struct mmap_region {
+	struct list_elem elem;       /* Element in supplemental_page_table. */
+	void *addr;                  /* First page of the region. */
+	size_t page_cnt;             /* Number of pages in the region. */
+
+	/* Readahead state. */
+	size_t last_fault;           /* Page index of the last fault. */
+	long stride;                 /* Distance between the last two faults. */
+	size_t ra_pages;             /* Current readahead window, in pages. */
+	bool faulted;                /* Has the region faulted yet? */
+};
+
+/* Readahead state of a page, see struct page. */
+enum readahead_state {
+	RA_NONE,                     /* Not involved in readahead. */
+	RA_QUEUED,                   /* Waiting for the readahead daemon. */
+	RA_LOADING                   /* Being read in by the daemon. */
+};
+
+/* Where the contents of a file-backed page come from: READ_BYTES bytes
+ * at OFFSET in FILE, followed by ZERO_BYTES zeroed bytes.  This is also the
+ * AUX of every uninit page that has an initializer, i.e. the lazily loaded
+ * executable segments and the mmaped pages.  FILE is a private handle of the
+ * page, which is closed when the page is destroyed.  A mmaped page maps
+ * CACHE, its page in the page cache, while it is resident. */
 struct file_page {
+	struct file *file;
+	off_t offset;
+	size_t read_bytes;
+	size_t zero_bytes;
+	struct mmap_region *region;  /* Mapping the page belongs to, or NULL
+	                                for an executable segment. */
+	struct cache_page *cache;    /* Mapped cache page, or NULL. */
+	struct list_elem cache_elem; /* Element in the mappers of CACHE. */
 };
 
 void vm_file_init (void);
 bool file_backed_initializer (struct page *page, enum vm_type type, void *kva);
+bool file_backed_lazy_load (struct page *page, void *aux);
+bool file_backed_claim (struct page *page, bool speculative);
+bool file_backed_cached (struct page *page);
 void *do_mmap(void *addr, size_t length, int writable,
 		struct file *file, off_t offset);
+void *do_mmap_shared (void *addr, size_t length, int writable,
+		struct file *file, off_t offset);
 void do_munmap (void *va);
+struct file_page *file_page_duplicate (const struct file_page *);
+void file_page_free (struct file_page *);
+bool file_mmap_copy (struct supplemental_page_table *dst,
+		struct supplemental_page_table *src);
+void file_mmap_rebind (struct file_page *, struct supplemental_page_table *);
+void file_mmap_kill (struct supplemental_page_table *);
+void file_readahead (struct page *page);
+void file_readahead_cancel (struct page *page);
+void file_readahead_page (struct page *page);
+void file_backed_discard (struct page *page);
 #endif
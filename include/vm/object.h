@@ -0,0 +1,38 @@
+#ifndef VM_OBJECT_H
+#define VM_OBJECT_H
+#include <stdbool.h>
+#include <stddef.h>
+#include "threads/synch.h"
+
+struct page;
+
+/* A shared memory object: the contents behind an anonymous shared
+ * mapping.  Every page that maps the object, in any process, refers to the
+ * same kernel page, so a store by one process is immediately seen by all
+ * others.  Shared mappings of files need no object, since their pages are
+ * already shared through the page cache.
+ *
+ * Object pages are not in the frame table and are never evicted.  Each
+ * mapping of one is charged to the mapping process as a locked page,
+ * against its resident set and its mlock() limit. */
+struct vm_object {
+	struct lock lock;            /* Protects the members below. */
+	int ref_cnt;                 /* Pages mapping the object, plus one
+	                                while it is being created. */
+	size_t page_cnt;             /* Number of pages. */
+	void **kpages;               /* Kernel page of each page, or NULL. */
+};
+
+/* A page that maps page IDX of OBJ. */
+struct shared_page {
+	struct vm_object *obj;
+	size_t idx;
+};
+
+struct vm_object *vm_object_create (size_t page_cnt);
+void vm_object_put (struct vm_object *obj);
+bool vm_object_map (struct vm_object *obj, size_t idx, void *va,
+		bool writable);
+bool shared_page_claim (struct page *page);
+
+#endif
@@ -1,6 +1,10 @@
 #ifndef VM_VM_H
 #define VM_VM_H
 #include <stdbool.h>
+#include <hash.h>
+#include <list.h>
+#include <madvise.h>
+#include <vmstat.h>
 #include "threads/palloc.h"
 
 enum vm_type {
@@ -12,6 +16,8 @@ enum vm_type {
 	VM_FILE = 2,
 	/* page that hold the page cache, for project 4 */
 	VM_PAGE_CACHE = 3,
+	/* page of a shared memory object, see vm/object.h */
+	VM_SHARED = 4,
 
 	/* Bit flags to store state */
 
@@ -20,6 +26,9 @@ enum vm_type {
 	VM_MARKER_0 = (1 << 3),
 	VM_MARKER_1 = (1 << 4),
 
+	/* Marks the pages of the user stack. */
+	VM_STACK = VM_MARKER_0,
+
 	/* DO NOT EXCEED THIS VALUE. */
 	VM_MARKER_END = (1 << 31),
 };
@@ -27,6 +36,7 @@ enum vm_type {
 #include "vm/uninit.h"
 #include "vm/anon.h"
 #include "vm/file.h"
+#include "vm/object.h"
 #ifdef EFILESYS
 #include "filesys/page_cache.h"
 #endif
@@ -36,6 +46,16 @@ struct thread;
 
 #define VM_TYPE(type) ((type) & 7)
 
+/* Number of pages in the fault-around window.  A fault on a file-backed
+ * page also brings in the other non-resident pages of the same file that
+ * fall in the naturally aligned window around the faulting address, so that
+ * a sequential scan takes one trap per window instead of one per page.
+ * Must be a power of 2. */
+#define FAULT_AROUND_PAGES 16
+
+/* Number of pages a stack growth fault adds below the faulting page. */
+#define STACK_PREFAULT_PAGES 8
+
 /* The representation of "page".
  * This is kind of "parent class", which has four "child class"es, which are
  * uninit_page, file_page, anon_page, and page cache (project4).
@@ -46,6 +66,16 @@ struct page {
 	struct frame *frame;   /* Back reference for frame */
 
 	/* Your implementation */
+	struct hash_elem spt_elem;   /* Element in supplemental_page_table. */
+	struct thread *owner;        /* Thread whose pml4 maps this page. */
+	bool writable;               /* Writable by the user process? */
+	bool ro_mapped;              /* Mapped read-only to a shared page, the
+	                                zero page or a KSM merged page? */
+	struct list_elem ra_elem;    /* Element in the readahead queue. */
+	enum readahead_state readahead; /* Readahead state (vm/file.c). */
+	int advice;                  /* MADV_NORMAL, MADV_RANDOM or
+	                                MADV_SEQUENTIAL, set by madvise(). */
+	bool locked;                 /* Locked in memory by mlock()? */
 
 	/* Per-type data are binded into the union.
 	 * Each function automatically detects the current union */
@@ -53,6 +83,7 @@ struct page {
 		struct uninit_page uninit;
 		struct anon_page anon;
 		struct file_page file;
+		struct shared_page shared;
 #ifdef EFILESYS
 		struct page_cache page_cache;
 #endif
@@ -63,6 +94,12 @@ struct page {
 struct frame {
 	void *kva;
 	struct page *page;
+	struct list_elem elem;       /* Element in the frame table. */
+	bool pinned;                 /* Neither evicted nor freed while set. */
+	bool referenced;             /* Accessed bit saved by the WSS sampler. */
+	uint64_t checksum;           /* Contents at the last KSM scan. */
+	struct hash_elem ksm_elem;   /* Element in the KSM unstable table. */
+	bool ksm_unstable;           /* In the KSM unstable table? */
 };
 
 /* The function table for page operations.
@@ -85,6 +122,8 @@ struct page_operations {
  * We don't want to force you to obey any specific design for this struct.
  * All designs up to you for this. */
 struct supplemental_page_table {
+	struct hash pages;           /* Pages hashed by user virtual address. */
+	struct list mmaps;           /* List of struct mmap_region. */
 };
 
 #include "threads/thread.h"
@@ -101,12 +140,41 @@ void vm_init (void);
 bool vm_try_handle_fault (struct intr_frame *f, void *addr, bool user,
 		bool write, bool not_present);
 
+extern size_t vm_stack_limit;
+extern size_t vm_rss_limit;
+extern bool vm_ksm_enabled;
+extern size_t vm_mlock_limit;
+extern bool vm_thp_enabled;
+
 #define vm_alloc_page(type, upage, writable) \
 	vm_alloc_page_with_initializer ((type), (upage), (writable), NULL, NULL)
+
 bool vm_alloc_page_with_initializer (enum vm_type type, void *upage,
 		bool writable, vm_initializer *init, void *aux);
 void vm_dealloc_page (struct page *page);
 bool vm_claim_page (void *va);
+bool vm_madvise (void *addr, size_t length, int advice);
+bool vm_mlock (void *addr, size_t length);
+bool vm_munlock (void *addr, size_t length);
+bool vm_charge_locked (struct thread *t);
+void vm_uncharge_locked (struct thread *t);
+bool vm_pin_user (const void *uaddr, size_t size, bool write);
+void vm_unpin_user (const void *uaddr, size_t size);
+bool vm_prefetch_page (struct page *page);
+void vm_free_frame (struct page *page);
+void *vm_get_kpage (void);
+bool vm_set_pte (struct page *page, void *kva);
+bool vm_clear_pte (struct page *page);
+bool vm_pte_accessed (struct page *page);
+bool vm_pte_dirty (struct page *page);
+bool vm_page_resident (struct page *page);
+void vm_ksm_put (struct ksm_node *node);
+struct frame *vm_pin_frame (struct page *page);
+void vm_unpin_frame (struct frame *frame);
 enum vm_type page_get_type (struct page *page);
 
+void vmstat_count (enum vmstat_event);
+void vmstat_fault_latency (uint64_t cycles);
+void vmstat_get (struct vmstat *);
+
 #endif  /* VM_VM_H */
@@ -0,0 +1,23 @@
+#ifndef VM_ZSWAP_H
+#define VM_ZSWAP_H
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Compressed swap cache.  Anonymous pages are compressed into an arena of
+ * kernel pages on eviction, and only go to the swap disk if the arena is
+ * full or the page does not compress. */
+
+/* A page stored in the arena. */
+struct zswap_entry {
+	size_t chunk;                /* First arena chunk. */
+	size_t len;                  /* Compressed length in bytes. */
+};
+
+extern size_t zswap_page_cnt;
+
+void zswap_init (void);
+bool zswap_store (const void *kva, struct zswap_entry *);
+void zswap_load (const struct zswap_entry *, void *kva);
+void zswap_free (const struct zswap_entry *);
+
+#endif
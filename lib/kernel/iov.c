@@ -0,0 +1,101 @@
+#include "iov.h"
+#include <debug.h>
+#include <string.h>
+
+/* Moves IT past the buffers that it has reached the end of. */
+static void
+skip_filled (struct iov_iter *it) {
+	while (it->cnt > 0 && it->ofs >= it->iov->iov_len) {
+		it->iov++;
+		it->cnt--;
+		it->ofs = 0;
+	}
+}
+
+/* Returns the number of bytes that IT can move in the current buffer,
+   up to SIZE. */
+static size_t
+chunk (const struct iov_iter *it, size_t size) {
+	size_t left = it->iov->iov_len - it->ofs;
+
+	return size < left ? size : left;
+}
+
+/* Initializes IT to the start of the CNT buffers in IOV, which must
+   outlive it. */
+void
+iov_iter_init (struct iov_iter *it, const struct iovec *iov, size_t cnt) {
+	ASSERT (it != NULL);
+	ASSERT (iov != NULL || cnt == 0);
+
+	it->iov = iov;
+	it->cnt = cnt;
+	it->ofs = 0;
+	skip_filled (it);
+}
+
+/* Initializes IT to the start of the SIZE bytes at BUF.  IT refers to
+   itself afterward, so it must not be copied. */
+void
+iov_iter_init_buf (struct iov_iter *it, void *buf, size_t size) {
+	it->single.iov_base = buf;
+	it->single.iov_len = size;
+	iov_iter_init (it, &it->single, 1);
+}
+
+/* Returns the address of the next SIZE bytes of IT if they lie in a
+   single buffer, otherwise a null pointer.  Does not advance IT. */
+void *
+iov_iter_contig (const struct iov_iter *it, size_t size) {
+	if (it->cnt == 0 || it->iov->iov_len - it->ofs < size)
+		return NULL;
+	return (char *) it->iov->iov_base + it->ofs;
+}
+
+/* Advances IT by SIZE bytes, or to its end if that comes first. */
+void
+iov_iter_advance (struct iov_iter *it, size_t size) {
+	while (size > 0 && it->cnt > 0) {
+		size_t n = chunk (it, size);
+
+		it->ofs += n;
+		size -= n;
+		skip_filled (it);
+	}
+}
+
+/* Copies SIZE bytes from SRC into the buffers of IT and advances IT.
+   Returns the number of bytes copied, less than SIZE if IT ran out. */
+size_t
+iov_iter_copy_to (struct iov_iter *it, const void *src_, size_t size) {
+	const char *src = src_;
+	size_t done = 0;
+
+	while (done < size && it->cnt > 0) {
+		size_t n = chunk (it, size - done);
+
+		memcpy ((char *) it->iov->iov_base + it->ofs, src + done, n);
+		it->ofs += n;
+		done += n;
+		skip_filled (it);
+	}
+	return done;
+}
+
+/* Copies SIZE bytes from the buffers of IT into DST and advances IT.
+   Returns the number of bytes copied, less than SIZE if IT ran out. */
+size_t
+iov_iter_copy_from (struct iov_iter *it, void *dst_, size_t size) {
+	char *dst = dst_;
+	size_t done = 0;
+
+	while (done < size && it->cnt > 0) {
+		size_t n = chunk (it, size - done);
+
+		memcpy (dst + done, (const char *) it->iov->iov_base + it->ofs, n);
+		it->ofs += n;
+		done += n;
+		skip_filled (it);
+	}
+	return done;
+}
@@ -0,0 +1,40 @@
+/* Copies between two files with copy_file_range(), starting at
+   unaligned positions, and checks the result and the positions. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE 5000
+
+void
+test_main (void)
+{
+  static char data[SIZE], buf[SIZE];
+  int in, out;
+  size_t i;
+
+  for (i = 0; i < SIZE; i++)
+    data[i] = i % 253;
+
+  CHECK (create ("source", SIZE), "create \"source\"");
+  CHECK (create ("target", SIZE), "create \"target\"");
+  CHECK ((in = open ("source")) > 1, "open \"source\"");
+  CHECK ((out = open ("target")) > 1, "open \"target\"");
+  CHECK (write (in, data, SIZE) == SIZE, "write \"source\"");
+
+  seek (in, 300);
+  seek (out, 100);
+  CHECK (copy_file_range (in, out, 4500) == 4500, "copy 4500 bytes");
+  CHECK (tell (in) == 4800 && tell (out) == 4600, "check positions");
+  CHECK (copy_file_range (in, out, 1000) == 200,
+         "copy stops at end of \"source\"");
+
+  CHECK (pread (out, buf, 4700, 100) == 4700, "read \"target\"");
+  if (memcmp (buf, data + 300, 4700))
+    fail ("\"target\" does not hold the copied bytes");
+
+  close (in);
+  close (out);
+}
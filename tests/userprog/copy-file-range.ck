@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(copy-file-range) begin
+(copy-file-range) create "source"
+(copy-file-range) create "target"
+(copy-file-range) open "source"
+(copy-file-range) open "target"
+(copy-file-range) write "source"
+(copy-file-range) copy 4500 bytes
+(copy-file-range) check positions
+(copy-file-range) copy stops at end of "source"
+(copy-file-range) read "target"
+(copy-file-range) end
+copy-file-range: exit(0)
+EOF
+pass;
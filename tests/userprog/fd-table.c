@@ -0,0 +1,45 @@
+/* Opens enough files to grow the descriptor table, checks that the
+   lowest free descriptor is reused, that dup2() shares the file
+   position and keeps the file open after the original is closed, and
+   that it can redirect the console to a file and back. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 200
+
+void
+test_main (void)
+{
+  char buf[10];
+  int fd, i, out, redirected, written;
+
+  for (i = 0; i < FILE_CNT; i++)
+    if ((fd = open ("sample.txt")) != i + 2)
+      fail ("open #%d returned %d instead of %d", i, fd, i + 2);
+  msg ("opened %d files", FILE_CNT);
+
+  close (50);
+  CHECK (open ("sample.txt") == 50, "lowest free descriptor is reused");
+
+  CHECK (dup2 (2, 1000) == 1000, "dup2 (2, 1000)");
+  CHECK (read (2, buf, 10) == 10, "read from 2");
+  CHECK (tell (1000) == 10, "1000 shares the position of 2");
+  close (2);
+  CHECK (read (1000, buf, 5) == 5 && tell (1000) == 15,
+         "1000 stays open after closing 2");
+
+  CHECK (create ("out.txt", 10), "create \"out.txt\"");
+  CHECK ((out = open ("out.txt")) > 1, "open \"out.txt\"");
+  CHECK (dup2 (1, 999) == 999, "dup2 (1, 999)");
+  redirected = dup2 (out, 1);
+  written = write (1, "redirected", 10);
+  CHECK (dup2 (999, 1) == 1, "dup2 (999, 1)");
+  CHECK (redirected == 1 && written == 10, "write to redirected 1");
+  close (999);
+  seek (out, 0);
+  CHECK (read (out, buf, 10) == 10 && !memcmp (buf, "redirected", 10),
+         "\"out.txt\" holds what was written to 1");
+}
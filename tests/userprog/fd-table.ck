@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(fd-table) begin
+(fd-table) opened 200 files
+(fd-table) lowest free descriptor is reused
+(fd-table) dup2 (2, 1000)
+(fd-table) read from 2
+(fd-table) 1000 shares the position of 2
+(fd-table) 1000 stays open after closing 2
+(fd-table) create "out.txt"
+(fd-table) open "out.txt"
+(fd-table) dup2 (1, 999)
+(fd-table) dup2 (999, 1)
+(fd-table) write to redirected 1
+(fd-table) "out.txt" holds what was written to 1
+(fd-table) end
+fd-table: exit(0)
+EOF
+pass;
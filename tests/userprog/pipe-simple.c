@@ -0,0 +1,42 @@
+/* Sends more data than a pipe holds from a child process to its
+   parent, so that both sides have to wait for each other, and
+   checks that the parent reads it all back in order, followed by
+   end of file. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE 100000
+
+void
+test_main (void)
+{
+  static char data[SIZE];
+  char buf[1000];
+  int fds[2];
+  int pid;
+  size_t total = 0;
+  int n, i;
+
+  for (i = 0; i < SIZE; i++)
+    data[i] = i % 251;
+
+  CHECK (pipe (fds) == 0, "pipe");
+  CHECK (read (fds[1], buf, 1) == -1, "read from write end fails");
+
+  if ((pid = fork ("child")) == 0) {
+    close (fds[0]);
+    exit (write (fds[1], data, SIZE) == SIZE ? 0 : 1);
+  }
+  close (fds[1]);
+
+  while ((n = read (fds[0], buf, sizeof buf)) > 0) {
+    for (i = 0; i < n; i++)
+      if (buf[i] != data[total + i])
+        fail ("byte %zu differs", total + i);
+    total += n;
+  }
+  msg ("read %zu bytes", total);
+  msg ("wait(fork()) = %d", wait (pid));
+}
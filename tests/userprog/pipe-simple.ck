@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pipe-simple) begin
+(pipe-simple) pipe
+(pipe-simple) read from write end fails
+child: exit(0)
+(pipe-simple) read 100000 bytes
+(pipe-simple) wait(fork()) = 0
+(pipe-simple) end
+pipe-simple: exit(0)
+EOF
+pass;
@@ -0,0 +1,47 @@
+/* Polls both ends of a pipe: with and without a timeout, while a
+   child process writes to it, and after the write end is closed. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  struct pollfd pfd[2];
+  int fds[2];
+  int pid, ready;
+  short revents;
+  char c;
+
+  CHECK (pipe (fds) == 0, "pipe");
+  pfd[0].fd = fds[0];
+  pfd[0].events = POLLIN;
+  pfd[1].fd = fds[1];
+  pfd[1].events = POLLOUT;
+  CHECK (poll (pfd, 2, 0) == 1 && pfd[0].revents == 0
+         && pfd[1].revents == POLLOUT, "only the write end is ready");
+  CHECK (poll (pfd, 1, 50) == 0, "read end times out");
+
+  if ((pid = fork ("child")) == 0) {
+    close (fds[0]);
+    write (fds[1], "x", 1);
+    exit (0);
+  }
+
+  /* Let the child exit before printing anything more. */
+  ready = poll (pfd, 1, -1);
+  revents = pfd[0].revents;
+  msg ("wait(fork()) = %d", wait (pid));
+  CHECK (ready == 1 && revents == POLLIN, "read end becomes readable");
+  CHECK (read (fds[0], &c, 1) == 1 && c == 'x', "read the byte");
+
+  close (fds[1]);
+  CHECK (poll (pfd, 1, -1) == 1 && pfd[0].revents == POLLHUP,
+         "hang up once no write end is left");
+
+  pfd[0].fd = 100;
+  pfd[1].fd = -1;
+  CHECK (poll (pfd, 2, 0) == 1 && pfd[0].revents == POLLNVAL
+         && pfd[1].revents == 0, "bad descriptor is reported, negative ignored");
+}
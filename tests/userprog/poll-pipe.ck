@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(poll-pipe) begin
+(poll-pipe) pipe
+(poll-pipe) only the write end is ready
+(poll-pipe) read end times out
+child: exit(0)
+(poll-pipe) wait(fork()) = 0
+(poll-pipe) read end becomes readable
+(poll-pipe) read the byte
+(poll-pipe) hang up once no write end is left
+(poll-pipe) bad descriptor is reported, negative ignored
+(poll-pipe) end
+poll-pipe: exit(0)
+EOF
+pass;
@@ -0,0 +1,32 @@
+/* Writes and reads records with pwrite() and pread(), and checks that
+   neither moves the file position. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  static const char record[] = "record at offset 700";
+  char buf[sizeof record];
+  int handle;
+
+  CHECK (create ("records", 1000), "create \"records\"");
+  CHECK ((handle = open ("records")) > 1, "open \"records\"");
+  seek (handle, 10);
+
+  CHECK (pwrite (handle, record, sizeof record, 700) == (int) sizeof record,
+         "pwrite \"records\"");
+  CHECK (tell (handle) == 10, "tell \"records\" after pwrite");
+  CHECK (pread (handle, buf, sizeof buf, 700) == (int) sizeof buf,
+         "pread \"records\"");
+  CHECK (tell (handle) == 10, "tell \"records\" after pread");
+  if (memcmp (buf, record, sizeof record))
+    fail ("pread() does not return what pwrite() wrote");
+
+  CHECK (pread (handle, buf, sizeof buf, 1000) == 0,
+         "pread \"records\" at end of file");
+  close (handle);
+}
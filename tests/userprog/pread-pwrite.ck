@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pread-pwrite) begin
+(pread-pwrite) create "records"
+(pread-pwrite) open "records"
+(pread-pwrite) pwrite "records"
+(pread-pwrite) tell "records" after pwrite
+(pread-pwrite) pread "records"
+(pread-pwrite) tell "records" after pread
+(pread-pwrite) pread "records" at end of file
+(pread-pwrite) end
+pread-pwrite: exit(0)
+EOF
+pass;
@@ -0,0 +1,35 @@
+/* Writes a file with writev() from buffers that split a disk sector,
+   then reads it back with readv() into differently split buffers,
+   including an empty one. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE 600
+
+void
+test_main (void)
+{
+  static char src[SIZE], dst[SIZE];
+  struct iovec out[] = {{src, 100}, {src + 100, 450}, {src + 550, 50}};
+  struct iovec in[] = {{dst, 300}, {dst + 300, 0}, {dst + 300, 300}};
+  int handle;
+  size_t i;
+
+  for (i = 0; i < SIZE; i++)
+    src[i] = i % 251;
+
+  CHECK (create ("vector", SIZE), "create \"vector\"");
+  CHECK ((handle = open ("vector")) > 1, "open \"vector\"");
+  CHECK (writev (handle, out, 3) == SIZE, "writev \"vector\"");
+  CHECK (tell (handle) == SIZE, "tell \"vector\" after writev");
+
+  seek (handle, 0);
+  CHECK (readv (handle, in, 3) == SIZE, "readv \"vector\"");
+  if (memcmp (src, dst, SIZE))
+    fail ("readv() does not return what writev() wrote");
+
+  close (handle);
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(readv-writev) begin
+(readv-writev) create "vector"
+(readv-writev) open "vector"
+(readv-writev) writev "vector"
+(readv-writev) tell "vector" after writev
+(readv-writev) readv "vector"
+(readv-writev) end
+readv-writev: exit(0)
+EOF
+pass;
@@ -0,0 +1,29 @@
+/* Spawns a child process without forking, closing a descriptor in
+   the child only, and waits for it. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  const char *argv[] = {"child-simple", NULL};
+  struct spawn_fd_action actions[] = {
+    {SPAWN_CLOSE, 0, 0},
+    {SPAWN_END, 0, 0},
+  };
+  int handle, pid;
+
+  CHECK (create ("spawn.txt", 0), "create \"spawn.txt\"");
+  CHECK ((handle = open ("spawn.txt")) > 1, "open \"spawn.txt\"");
+  actions[0].fd = handle;
+  CHECK ((pid = spawn ("child-simple", argv, actions)) != PID_ERROR,
+         "spawn \"child-simple\"");
+  msg ("wait(spawn()) = %d", wait (pid));
+
+  actions[0].fd = 100;
+  CHECK (spawn ("child-simple", argv, actions) == PID_ERROR,
+         "spawn with a bad descriptor action fails");
+  CHECK (filesize (handle) == 0, "descriptor still open in the parent");
+}
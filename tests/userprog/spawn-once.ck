@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(spawn-once) begin
+(spawn-once) create "spawn.txt"
+(spawn-once) open "spawn.txt"
+(spawn-once) spawn "child-simple"
+(child-simple) run
+child-simple: exit(81)
+(spawn-once) wait(spawn()) = 81
+(spawn-once) spawn with a bad descriptor action fails
+(spawn-once) descriptor still open in the parent
+(spawn-once) end
+spawn-once: exit(0)
+EOF
+pass;
@@ -0,0 +1,40 @@
+/* Checks madvise(): MADV_DONTNEED turns anonymous memory back into
+   zeros and makes a file mapping read the file again, and the access
+   pattern hints leave the contents alone. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[3 * 4096];
+
+void
+test_main (void)
+{
+  char *anon = (char *) (((uintptr_t) buf + 4095) & ~(uintptr_t) 4095);
+  char *actual = (char *) 0x10000000;
+  int handle;
+  size_t i;
+
+  memset (anon, 0x5a, 2 * 4096);
+  CHECK (madvise (anon, 2 * 4096, MADV_DONTNEED), "madvise DONTNEED");
+  for (i = 0; i < 2 * 4096; i++)
+    if (anon[i] != 0)
+      fail ("byte %zu not zero after MADV_DONTNEED", i);
+  CHECK (!madvise (anon + 1, 4096, MADV_NORMAL), "unaligned madvise fails");
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (mmap (actual, 4096, 0, handle, 0) != MAP_FAILED,
+         "mmap \"sample.txt\"");
+  CHECK (madvise (actual, 4096, MADV_SEQUENTIAL), "madvise SEQUENTIAL");
+  CHECK (madvise (actual, 4096, MADV_WILLNEED), "madvise WILLNEED");
+  if (memcmp (actual, sample, strlen (sample)))
+    fail ("read of mmap'd file reported bad data");
+  CHECK (madvise (actual, 4096, MADV_DONTNEED), "madvise DONTNEED");
+  if (memcmp (actual, sample, strlen (sample)))
+    fail ("mmap'd file not read back after MADV_DONTNEED");
+  munmap (actual);
+  close (handle);
+}
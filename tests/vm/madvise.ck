@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(madvise) begin
+(madvise) madvise DONTNEED
+(madvise) unaligned madvise fails
+(madvise) open "sample.txt"
+(madvise) mmap "sample.txt"
+(madvise) madvise SEQUENTIAL
+(madvise) madvise WILLNEED
+(madvise) madvise DONTNEED
+(madvise) end
+EOF
+pass;
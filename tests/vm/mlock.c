@@ -0,0 +1,33 @@
+/* Locks and unlocks anonymous memory, and checks that mlock()
+   enforces the per-process limit. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define BIG_PAGES 1024
+
+void
+test_main (void)
+{
+  char *mem = (char *) 0x54321000;
+  char *big = (char *) 0x60000000;
+  size_t i;
+
+  CHECK (mmap_shared (mem, 2 * 4096, 1, -1, 0) != MAP_FAILED,
+         "mmap_shared");
+  CHECK (mlock (mem + 100, 4096), "mlock");
+  memset (mem, 0x5a, 2 * 4096);
+  for (i = 0; i < 2 * 4096; i++)
+    if (mem[i] != 0x5a)
+      fail ("byte %zu of locked memory is wrong", i);
+  CHECK (munlock (mem, 2 * 4096), "munlock");
+  CHECK (!mlock (mem + 4 * 4096, 4096), "mlock of unmapped memory fails");
+
+  CHECK (mmap_shared (big, BIG_PAGES * 4096, 1, -1, 0) != MAP_FAILED,
+         "mmap_shared big");
+  CHECK (!mlock (big, BIG_PAGES * 4096), "mlock over the limit fails");
+  munmap (big);
+  munmap (mem);
+}
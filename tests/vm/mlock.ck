@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mlock) begin
+(mlock) mmap_shared
+(mlock) mlock
+(mlock) munlock
+(mlock) mlock of unmapped memory fails
+(mlock) mmap_shared big
+(mlock) mlock over the limit fails
+(mlock) end
+EOF
+pass;
@@ -0,0 +1,38 @@
+/* Checks that a file mapping and read()/write() on the same file see
+   each other's modifications at once, without munmap in between. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  static const char msg1[] = "stored through the mapping";
+  static const char msg2[] = "written with write()";
+  char *actual = (char *) 0x10000000;
+  char buf[sizeof msg1];
+  int handle;
+
+  CHECK (create ("coherent", 2 * 4096), "create \"coherent\"");
+  CHECK ((handle = open ("coherent")) > 1, "open \"coherent\"");
+  CHECK (mmap (actual, 2 * 4096, 1, handle, 0) != MAP_FAILED,
+         "mmap \"coherent\"");
+
+  memcpy (actual + 100, msg1, sizeof msg1);
+  seek (handle, 100);
+  CHECK (read (handle, buf, sizeof msg1) == (int) sizeof msg1,
+         "read \"coherent\"");
+  if (memcmp (buf, msg1, sizeof msg1))
+    fail ("read() does not see store through mapping");
+
+  seek (handle, 4096 + 200);
+  CHECK (write (handle, msg2, sizeof msg2) == (int) sizeof msg2,
+         "write \"coherent\"");
+  if (memcmp (actual + 4096 + 200, msg2, sizeof msg2))
+    fail ("mapping does not see write()");
+
+  munmap (actual);
+  close (handle);
+}
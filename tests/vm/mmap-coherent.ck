@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-coherent) begin
+(mmap-coherent) create "coherent"
+(mmap-coherent) open "coherent"
+(mmap-coherent) mmap "coherent"
+(mmap-coherent) read "coherent"
+(mmap-coherent) write "coherent"
+(mmap-coherent) end
+EOF
+pass;
@@ -0,0 +1,34 @@
+/* Maps shared anonymous memory, forks, and checks that the parent
+   and the child see each other's writes. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHILD_MSG "written by the child"
+
+void
+test_main (void)
+{
+  char *shared = (char *) 0x54321000;
+  pid_t child;
+
+  CHECK (mmap_shared (shared, 2 * 4096, 1, -1, 0) != MAP_FAILED,
+         "mmap_shared");
+  if (shared[0] != 0 || shared[4096] != 0)
+    fail ("shared memory not zeroed");
+  strlcpy (shared, "written by the parent", 4096);
+
+  child = fork ("child");
+  if (child == 0)
+    {
+      if (strcmp (shared, "written by the parent"))
+        fail ("child does not see parent's data");
+      strlcpy (shared + 4096, CHILD_MSG, 4096);
+      exit (0);
+    }
+  CHECK (wait (child) == 0, "wait for child");
+  CHECK (!strcmp (shared + 4096, CHILD_MSG), "parent sees child's data");
+  munmap (shared);
+}
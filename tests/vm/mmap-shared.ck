@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-shared) begin
+(mmap-shared) mmap_shared
+(mmap-shared) wait for child
+(mmap-shared) parent sees child's data
+(mmap-shared) end
+EOF
+pass;
@@ -0,0 +1,47 @@
+/* Touches fresh anonymous memory and checks that vmstat() counted
+   the page faults and their handling times. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_CNT 4
+
+static uint64_t
+latency_total (const struct vmstat *st)
+{
+  uint64_t total = 0;
+  int i;
+
+  for (i = 0; i < VMSTAT_LATENCY_BUCKETS; i++)
+    total += st->fault_latency[i];
+  return total;
+}
+
+void
+test_main (void)
+{
+  static struct vmstat before, after;
+  char *mem = (char *) 0x54321000;
+  uint64_t faults;
+  int i;
+
+  CHECK (vmstat (&before), "vmstat before");
+  CHECK (mmap_shared (mem, PAGE_CNT * 4096, 1, -1, 0) != MAP_FAILED,
+         "mmap_shared");
+  for (i = 0; i < PAGE_CNT; i++)
+    mem[i * 4096] = i;
+  CHECK (vmstat (&after), "vmstat after");
+
+  faults = (after.events[VMSTAT_FAULT_MINOR] - before.events[VMSTAT_FAULT_MINOR])
+           + (after.events[VMSTAT_FAULT_MAJOR]
+              - before.events[VMSTAT_FAULT_MAJOR]);
+  if (faults < PAGE_CNT)
+    fail ("%d faults counted, expected at least %d", (int) faults, PAGE_CNT);
+  if (after.events[VMSTAT_FAULT_ANON] - before.events[VMSTAT_FAULT_ANON]
+      < PAGE_CNT)
+    fail ("anonymous faults not counted");
+  if (latency_total (&after) - latency_total (&before) < faults)
+    fail ("fault latency histogram missing faults");
+  munmap (mem);
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(vmstat) begin
+(vmstat) vmstat before
+(vmstat) mmap_shared
+(vmstat) vmstat after
+(vmstat) end
+EOF
+pass;
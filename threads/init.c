@@ -31,6 +31,7 @@
 #include "tests/threads/tests.h"
 #ifdef VM
 #include "vm/vm.h"
+#include "vm/zswap.h"
 #endif
 #ifdef FILESYS
 #include "devices/disk.h"
@@ -226,6 +227,20 @@ parse_options (char **argv) {
 			user_page_limit = atoi (value);
 		else if (!strcmp (name, "-threads-tests"))
 			thread_tests = true;
+#endif
+#ifdef VM
+		else if (!strcmp (name, "-stack"))
+			vm_stack_limit = atoi (value);
+		else if (!strcmp (name, "-rss"))
+			vm_rss_limit = atoi (value);
+		else if (!strcmp (name, "-zswap"))
+			zswap_page_cnt = atoi (value);
+		else if (!strcmp (name, "-ksm"))
+			vm_ksm_enabled = true;
+		else if (!strcmp (name, "-mlock"))
+			vm_mlock_limit = atoi (value);
+		else if (!strcmp (name, "-thp"))
+			vm_thp_enabled = true;
 #endif
 		else
 			PANIC ("unknown option `%s' (use -h for help)", name);
@@ -328,6 +343,14 @@ usage (void) {
 			"  -mlfqs             Use multi-level feedback queue scheduler.\n"
 #ifdef USERPROG
 			"  -ul=COUNT          Limit user memory to COUNT pages.\n"
+#endif
+#ifdef VM
+			"  -stack=COUNT       Limit user stacks to COUNT pages.\n"
+			"  -rss=COUNT         Limit each process to COUNT resident pages.\n"
+			"  -zswap=COUNT       Use COUNT kernel pages for compressed swap.\n"
+			"  -ksm               Merge identical anonymous pages.\n"
+			"  -mlock=COUNT       Let each process lock COUNT pages.\n"
+			"  -thp               Map large anonymous regions with huge pages.\n"
 #endif
 			);
 	power_off ();
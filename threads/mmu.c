@@ -8,11 +8,35 @@
 #include "threads/mmu.h"
 #include "intrinsic.h"
 
+/* Replaces the huge page mapping in PDE, which covers VA, by a page table
+ * of 4 kB mappings of the same memory with the same permissions, so that
+ * parts of it can be changed.  Panics if no page table can be allocated. */
+static void
+pde_split (uint64_t *pde, const uint64_t va) {
+	uint64_t *pt = palloc_get_page (PAL_ASSERT);
+	uint64_t pa = PTE_ADDR (*pde);
+	uint64_t flags = *pde & (PTE_P | PTE_W | PTE_U | PTE_A | PTE_D);
+
+	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++)
+		pt[i] = (pa + i * PGSIZE) | flags;
+	*pde = vtop (pt) | PTE_U | PTE_W | PTE_P;
+	/* Drops the huge TLB entry, if this is the active page table. */
+	invlpg (va);
+}
+
+/* For a VA that is mapped by a huge page, returns the PDE itself, unless
+ * CREATE, in which case the huge page is split first. */
 static uint64_t *
 pgdir_walk (uint64_t *pdp, const uint64_t va, int create) {
 	int idx = PDX (va);
 	if (pdp) {
 		uint64_t *pte = (uint64_t *) pdp[idx];
+		if ((uint64_t) pte & PTE_PS) {
+			if (!create)
+				return &pdp[idx];
+			pde_split (&pdp[idx], va);
+			pte = (uint64_t *) pdp[idx];
+		}
 		if (!((uint64_t) pte & PTE_P)) {
 			if (create) {
 				uint64_t *new_page = palloc_get_page (PAL_ZERO);
@@ -117,11 +141,15 @@ pt_for_each (uint64_t *pt, pte_for_each_func *func, void *aux,
 	return true;
 }
 
+/* Huge pages are skipped: they are only mapped by the VM code, which
+ * does not walk page tables. */
 static bool
 pgdir_for_each (uint64_t *pdp, pte_for_each_func *func, void *aux,
 		unsigned pml4_index, unsigned pdp_index) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pdp[i]);
+		if (pdp[i] & PTE_PS)
+			continue;
 		if (((uint64_t) pte) & PTE_P)
 			if (!pt_for_each ((uint64_t *) PTE_ADDR (pte), func, aux,
 					pml4_index, pdp_index, i))
@@ -165,10 +193,13 @@ pt_destroy (uint64_t *pt) {
 	palloc_free_page ((void *) pt);
 }
 
+/* Huge pages are left alone, their memory belongs to the VM code. */
 static void
 pgdir_destroy (uint64_t *pdp) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pdp[i]);
+		if (pdp[i] & PTE_PS)
+			continue;
 		if (((uint64_t) pte) & PTE_P)
 			pt_destroy (PTE_ADDR (pte));
 	}
@@ -216,6 +247,8 @@ pml4_get_page (uint64_t *pml4, const void *uaddr) {
 
 	uint64_t *pte = pml4e_walk (pml4, (uint64_t) uaddr, 0);
 
+	if (pte && (*pte & PTE_P) && (*pte & PTE_PS))
+		return ptov (PTE_ADDR (*pte)) + ((uint64_t) uaddr & (HPGSIZE - 1));
 	if (pte && (*pte & PTE_P))
 		return ptov (PTE_ADDR (*pte)) + pg_ofs (uaddr);
 	return NULL;
@@ -243,6 +276,89 @@ pml4_set_page (uint64_t *pml4, void *upage, void *kpage, bool rw) {
 	return pte != NULL;
 }
 
+/* Returns the address of the PDE for virtual address VA in PML4, creating
+ * the page directory and its parents if CREATE.  Returns a null pointer
+ * if they do not exist or cannot be created. */
+static uint64_t *
+pml4e_walk_pde (uint64_t *pml4, const uint64_t va, int create) {
+	uint64_t *pdpe, *pdp;
+
+	if (!(pml4[PML4 (va)] & PTE_P)) {
+		uint64_t *new_page = create ? palloc_get_page (PAL_ZERO) : NULL;
+		if (new_page == NULL)
+			return NULL;
+		pml4[PML4 (va)] = vtop (new_page) | PTE_U | PTE_W | PTE_P;
+	}
+	pdpe = ptov (PTE_ADDR (pml4[PML4 (va)]));
+	if (!(pdpe[PDPE (va)] & PTE_P)) {
+		uint64_t *new_page = create ? palloc_get_page (PAL_ZERO) : NULL;
+		if (new_page == NULL)
+			return NULL;
+		pdpe[PDPE (va)] = vtop (new_page) | PTE_U | PTE_W | PTE_P;
+	}
+	pdp = ptov (PTE_ADDR (pdpe[PDPE (va)]));
+	return &pdp[PDX (va)];
+}
+
+/* Maps the HPGSIZE bytes at user virtual address UPAGE to the physically
+ * contiguous memory at kernel virtual address KPAGE with a single huge
+ * page, read/write if RW.  Both must be HPGSIZE aligned.  None of UPAGE
+ * may be mapped yet; a page table left over from earlier mappings there is
+ * freed.  Returns true if successful, false if memory allocation failed or
+ * part of UPAGE is mapped.
+ *
+ * The huge page is split back into 4 kB mappings as soon as one of them
+ * is changed with pml4_set_page() or pml4_clear_page().  Until then, it has
+ * a single dirty bit and a single accessed bit, which the functions below
+ * report and change for all of its pages at once. */
+bool
+pml4_set_huge_page (uint64_t *pml4, void *upage, void *kpage, bool rw) {
+	uint64_t *pde;
+
+	ASSERT (((uint64_t) upage & (HPGSIZE - 1)) == 0);
+	ASSERT ((vtop (kpage) & (HPGSIZE - 1)) == 0);
+	ASSERT (is_user_vaddr (upage));
+	ASSERT (pml4 != base_pml4);
+
+	pde = pml4e_walk_pde (pml4, (uint64_t) upage, 1);
+	if (pde == NULL)
+		return false;
+	if (*pde & PTE_P) {
+		uint64_t *pt = ptov (PTE_ADDR (*pde));
+
+		if (*pde & PTE_PS)
+			return false;
+		for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++)
+			if (pt[i] & PTE_P)
+				return false;
+		*pde = 0;
+		/* The CPU may have cached the PDE. */
+		if (rcr3 () == vtop (pml4))
+			invlpg ((uint64_t) upage);
+		palloc_free_page (pt);
+	}
+	*pde = vtop (kpage) | PTE_P | PTE_PS | (rw ? PTE_W : 0) | PTE_U;
+	return true;
+}
+
+/* Removes the huge page mapping of the HPGSIZE bytes at user virtual
+ * address UPAGE, as made by pml4_set_huge_page(), leaving all of them
+ * unmapped.  Does nothing if UPAGE is not mapped by a huge page. */
+void
+pml4_clear_huge_page (uint64_t *pml4, void *upage) {
+	uint64_t *pde;
+
+	ASSERT (((uint64_t) upage & (HPGSIZE - 1)) == 0);
+	ASSERT (is_user_vaddr (upage));
+
+	pde = pml4e_walk_pde (pml4, (uint64_t) upage, 0);
+	if (pde != NULL && (*pde & PTE_PS) != 0) {
+		*pde = 0;
+		if (rcr3 () == vtop (pml4))
+			invlpg ((uint64_t) upage);
+	}
+}
+
 /* Marks user virtual page UPAGE "not present" in page
  * directory PD.  Later accesses to the page will fault.  Other
  * bits in the page table entry are preserved.
@@ -254,6 +370,9 @@ pml4_clear_page (uint64_t *pml4, void *upage) {
 	ASSERT (is_user_vaddr (upage));
 
 	pte = pml4e_walk (pml4, (uint64_t) upage, false);
+	/* Split a huge page, so that only UPAGE goes. */
+	if (pte != NULL && (*pte & PTE_PS) != 0)
+		pte = pml4e_walk (pml4, (uint64_t) upage, true);
 
 	if (pte != NULL && (*pte & PTE_P) != 0) {
 		*pte &= ~PTE_P;
@@ -31,6 +31,7 @@ struct pool {
 	struct lock lock;               /* Mutual exclusion. */
 	struct bitmap *used_map;        /* Bitmap of free pages. */
 	uint8_t *base;                  /* Base of pool. */
+	size_t free_cnt;                /* Number of free pages. */
 };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -232,6 +233,11 @@ split:
 			}
 		}
 	}
+
+	kernel_pool.free_cnt = bitmap_count (kernel_pool.used_map, 0,
+			bitmap_size (kernel_pool.used_map), false);
+	user_pool.free_cnt = bitmap_count (user_pool.used_map, 0,
+			bitmap_size (user_pool.used_map), false);
 }
 
 /* Initializes the page allocator and get the memory size */
@@ -265,6 +271,49 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 
 	lock_acquire (&pool->lock);
 	size_t page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
+	if (page_idx != BITMAP_ERROR)
+		__atomic_fetch_sub (&pool->free_cnt, page_cnt, __ATOMIC_RELAXED);
+	lock_release (&pool->lock);
+	void *pages;
+
+	if (page_idx != BITMAP_ERROR)
+		pages = pool->base + PGSIZE * page_idx;
+	else
+		pages = NULL;
+
+	if (pages) {
+		if (flags & PAL_ZERO)
+			memset (pages, 0, PGSIZE * page_cnt);
+	} else {
+		if (flags & PAL_ASSERT)
+			PANIC ("palloc_get: out of pages");
+	}
+
+	return pages;
+}
+
+/* Obtains PAGE_CNT contiguous free pages, like palloc_get_multiple(),
+   that start at a multiple of PAGE_CNT pages, which must be a power of
+   two.  Used for huge pages, which must be aligned to their size. */
+void *
+palloc_get_aligned (enum palloc_flags flags, size_t page_cnt) {
+	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	uint64_t align = page_cnt * PGSIZE;
+	size_t page_idx = BITMAP_ERROR;
+	size_t idx;
+
+	ASSERT (page_cnt > 0 && (page_cnt & (page_cnt - 1)) == 0);
+
+	lock_acquire (&pool->lock);
+	for (idx = (ROUND_UP ((uint64_t) pool->base, align)
+				- (uint64_t) pool->base) / PGSIZE;
+			idx + page_cnt <= bitmap_size (pool->used_map); idx += page_cnt)
+		if (bitmap_none (pool->used_map, idx, page_cnt)) {
+			bitmap_set_multiple (pool->used_map, idx, page_cnt, true);
+			__atomic_fetch_sub (&pool->free_cnt, page_cnt, __ATOMIC_RELAXED);
+			page_idx = idx;
+			break;
+		}
 	lock_release (&pool->lock);
 	void *pages;
 
@@ -320,6 +369,7 @@ palloc_free_multiple (void *pages, size_t page_cnt) {
 #endif
 	ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
 	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+	__atomic_fetch_add (&pool->free_cnt, page_cnt, __ATOMIC_RELAXED);
 }
 
 /* Frees the page at PAGE. */
@@ -328,6 +378,15 @@ palloc_free_page (void *page) {
 	palloc_free_multiple (page, 1);
 }
 
+/* Returns the number of free pages in the user pool if PAL_USER is set
+   in FLAGS, otherwise in the kernel pool. */
+size_t
+palloc_free_cnt (enum palloc_flags flags) {
+	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+
+	return __atomic_load_n (&pool->free_cnt, __ATOMIC_RELAXED);
+}
+
 /* Initializes pool P as starting at START and ending at END */
 static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
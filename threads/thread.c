@@ -322,6 +322,17 @@ void ///* Sleep queue에서 깨워야 할 thread를 찾아서 wake */
 //  }
 //}
 
+/* Wakes T, which is asleep in thread_sleep(), before its wake time.
+   Interrupts must be off. */
+void
+thread_wake (struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (t->status == THREAD_BLOCKED);
+
+	list_remove (&t->elem);
+	thread_unblock (t);
+}
+
 /* Returns the name of the running thread. */
 const char *
 thread_name (void) {
@@ -484,6 +495,12 @@ init_thread (struct thread *t, const char *name, int priority) {
 	t->tf.rsp = (uint64_t) t + PGSIZE - sizeof (void *);
 	t->priority = priority;
 	t->magic = THREAD_MAGIC;
+#ifdef USERPROG
+	list_init (&t->children);
+#endif
+#ifdef VM
+	t->rss_limit = vm_rss_limit;
+#endif
 }
 
 /* Chooses and returns the next thread to be scheduled.  Should
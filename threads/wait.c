@@ -0,0 +1,102 @@
+/* wait.c: Wait queues for poll().
+ *
+ * A thread in poll() puts an entry of its poll table on the wait queue
+ * of each object that it watches, then sleeps.  Whatever makes one of
+ * the objects ready wakes the queue, which wakes the thread early from
+ * its sleep; otherwise the timer does at the deadline.  Queues are
+ * manipulated with interrupts off, so they can be woken from interrupt
+ * handlers such as the keyboard's. */
+
+#include "threads/wait.h"
+#include <debug.h>
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+
+/* Initializes Q as an empty wait queue. */
+void
+wait_queue_init (struct wait_queue *q) {
+	list_init (&q->waiters);
+}
+
+/* Wakes every thread waiting on Q.  May be called from an interrupt
+ * handler. */
+void
+wait_queue_wake (struct wait_queue *q) {
+	enum intr_level old_level = intr_disable ();
+
+	for (struct list_elem *e = list_begin (&q->waiters);
+			e != list_end (&q->waiters); e = list_next (e)) {
+		struct poll_table *pt = list_entry (e, struct poll_entry, elem)->table;
+
+		/* A thread that the timer has already woken is no longer
+		 * blocked, although it has not cleared BLOCKED yet. */
+		pt->triggered = true;
+		if (pt->blocked && pt->thread->status == THREAD_BLOCKED)
+			thread_wake (pt->thread);
+		pt->blocked = false;
+	}
+	intr_set_level (old_level);
+}
+
+/* Initializes PT for the current thread, with room for CAPACITY
+ * entries in ENTRIES. */
+void
+poll_table_init (struct poll_table *pt, struct poll_entry *entries,
+		size_t capacity) {
+	pt->thread = thread_current ();
+	pt->entries = entries;
+	pt->cnt = 0;
+	pt->capacity = capacity;
+	pt->triggered = false;
+	pt->blocked = false;
+}
+
+/* Puts PT on Q, so that waking Q ends poll_table_wait().  PT may be a
+ * null pointer, for checking an object without waiting on it. */
+void
+poll_table_add (struct poll_table *pt, struct wait_queue *q) {
+	struct poll_entry *entry;
+	enum intr_level old_level;
+
+	if (pt == NULL)
+		return;
+	ASSERT (pt->cnt < pt->capacity);
+
+	entry = &pt->entries[pt->cnt++];
+	entry->table = pt;
+	entry->queue = q;
+	old_level = intr_disable ();
+	list_push_back (&q->waiters, &entry->elem);
+	intr_set_level (old_level);
+}
+
+/* Sleeps until one of the queues that PT is on is woken, or until timer
+ * tick WAKE_TIME, which may be INT64_MAX to wait without a deadline.
+ * Returns at once if a queue was woken since the last call.  Returns
+ * true if a queue was woken, false if the deadline passed. */
+bool
+poll_table_wait (struct poll_table *pt, int64_t wake_time) {
+	enum intr_level old_level = intr_disable ();
+	bool triggered;
+
+	ASSERT (pt->thread == thread_current ());
+	if (!pt->triggered) {
+		pt->blocked = true;
+		thread_sleep (wake_time);
+		pt->blocked = false;
+	}
+	triggered = pt->triggered;
+	pt->triggered = false;
+	intr_set_level (old_level);
+	return triggered;
+}
+
+/* Takes PT off all the queues that it is on. */
+void
+poll_table_destroy (struct poll_table *pt) {
+	enum intr_level old_level = intr_disable ();
+
+	for (size_t i = 0; i < pt->cnt; i++)
+		list_remove (&pt->entries[i].elem);
+	intr_set_level (old_level);
+}
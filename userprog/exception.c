@@ -9,8 +9,12 @@
 /* Number of page faults processed. */
 static long long page_fault_cnt;
 
+/* Exception table bounds, set by the linker. */
+extern const struct exception_entry __start_ex_table[], __stop_ex_table[];
+
 static void kill (struct intr_frame *);
 static void page_fault (struct intr_frame *);
+static const struct exception_entry *search_exception_table (uint64_t rip);
 
 /* Registers handlers for interrupts that can be caused by user
    programs.
@@ -142,10 +146,25 @@ page_fault (struct intr_frame *f) {
 
 #ifdef VM
 	/* For project 3 and later. */
-	if (vm_try_handle_fault (f, fault_addr, user, write, not_present))
+	uint64_t start = rdtsc ();
+	bool handled = vm_try_handle_fault (f, fault_addr, user, write,
+			not_present);
+	vmstat_fault_latency (rdtsc () - start);
+	if (handled)
 		return;
 #endif
 
+	/* A kernel fault at an instruction listed in the exception table
+	   is an access to user memory on behalf of a system call.  Let
+	   the access fail instead of killing the kernel. */
+	if (!user) {
+		const struct exception_entry *e = search_exception_table (f->rip);
+		if (e != NULL) {
+			f->rip = e->fixup;
+			return;
+		}
+	}
+
 	/* Count page faults. */
 	page_fault_cnt++;
 
@@ -158,3 +177,16 @@ page_fault (struct intr_frame *f) {
 	kill (f);
 }
 
+/* Returns the exception table entry for the instruction at RIP,
+   or a null pointer if it has none.  The table only holds the
+   handful of instructions that touch user memory, so a linear
+   search is enough. */
+static const struct exception_entry *
+search_exception_table (uint64_t rip) {
+	const struct exception_entry *e;
+
+	for (e = __start_ex_table; e < __stop_ex_table; e++)
+		if (e->insn == rip)
+			return e;
+	return NULL;
+}
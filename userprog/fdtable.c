@@ -0,0 +1,240 @@
+/* fdtable.c: File descriptor tables of user processes.
+ *
+ * Functions that close files need filesys_lock, which their callers
+ * hold.  A table is only used by its own process, except that a child
+ * copies its parent's while the parent waits. */
+
+#include "userprog/fdtable.h"
+#include <debug.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+
+/* Size of a new table. */
+#define FD_INIT_SIZE 64
+
+/* Word of the map that holds the bit of FD. */
+#define FD_WORD(FD) ((FD) / 64)
+
+/* Mask of the bit of FD in its word. */
+#define FD_BIT(FD) ((uint64_t) 1 << ((FD) % 64))
+
+/* Marks FD in use in T. */
+static void
+mark_used (struct fd_table *t, int fd) {
+	uint64_t *word = &t->map[FD_WORD (fd)];
+
+	*word |= FD_BIT (fd);
+	if (*word == UINT64_MAX)
+		t->summary |= FD_BIT (FD_WORD (fd));
+}
+
+/* Marks FD free in T. */
+static void
+mark_free (struct fd_table *t, int fd) {
+	t->map[FD_WORD (fd)] &= ~FD_BIT (fd);
+	t->summary &= ~FD_BIT (FD_WORD (fd));
+}
+
+/* Returns the lowest descriptor that is free in T, which may be beyond
+ * its size, or -1 if all FD_MAX are in use. */
+static int
+lowest_free (const struct fd_table *t) {
+	int word;
+
+	if (t->summary == UINT64_MAX)
+		return -1;
+	word = __builtin_ctzll (~t->summary);
+	if (word * 64 >= t->size)
+		return word * 64;
+	return word * 64 + __builtin_ctzll (~t->map[word]);
+}
+
+/* Grows T, if necessary, to have room for descriptor FD, which must be
+ * less than FD_MAX.  Returns false if memory runs out. */
+static bool
+grow (struct fd_table *t, int fd) {
+	struct file **files;
+	uint64_t *map;
+	int size = t->size;
+
+	ASSERT (fd < FD_MAX);
+	if (fd < size)
+		return true;
+	while (size <= fd)
+		size *= 2;
+
+	files = realloc (t->files, size * sizeof *files);
+	if (files == NULL)
+		return false;
+	t->files = files;
+	map = realloc (t->map, FD_WORD (size) * sizeof *map);
+	if (map == NULL)
+		return false;
+	t->map = map;
+
+	memset (files + t->size, 0, (size - t->size) * sizeof *files);
+	memset (map + FD_WORD (t->size), 0,
+			(FD_WORD (size) - FD_WORD (t->size)) * sizeof *map);
+	t->size = size;
+	return true;
+}
+
+/* Initializes T as a table with just the console's keyboard open as
+ * descriptor 0 and its display as descriptor 1.  Returns false if memory
+ * runs out. */
+bool
+fd_table_init (struct fd_table *t) {
+	t->files = calloc (FD_INIT_SIZE, sizeof *t->files);
+	t->map = calloc (FD_WORD (FD_INIT_SIZE), sizeof *t->map);
+	t->summary = 0;
+	t->size = FD_INIT_SIZE;
+	if (t->files == NULL || t->map == NULL) {
+		free (t->files);
+		free (t->map);
+		t->files = NULL;
+		return false;
+	}
+	if (fd_table_install (t, file_open_console (false)) != 0
+			|| fd_table_install (t, file_open_console (true)) != 1) {
+		fd_table_destroy (t);
+		return false;
+	}
+	return true;
+}
+
+/* Calls FUNC on each descriptor of T that refers to a file, in
+ * ascending order, until it returns false.  Returns false if FUNC did.
+ * Only the words of the map with bits set are looked at. */
+static bool
+for_each_fd (const struct fd_table *t,
+		bool (*func) (const struct fd_table *, int fd, void *aux),
+		void *aux) {
+	for (int word = 0; word < FD_WORD (t->size); word++)
+		for (uint64_t bits = t->map[word]; bits != 0; bits &= bits - 1) {
+			int fd = word * 64 + __builtin_ctzll (bits);
+
+			if (t->files[fd] != NULL && !func (t, fd, aux))
+				return false;
+		}
+	return true;
+}
+
+/* for_each_fd() function for fd_table_copy(): duplicates the file of SRC
+ * at FD into the table AUX.  A file that several descriptors share is
+ * duplicated once, and the duplicate shared in the same way. */
+static bool
+copy_fd (const struct fd_table *src, int fd, void *dst_) {
+	struct fd_table *dst = dst_;
+	struct file *file = src->files[fd];
+
+	if (file_is_shared (file))
+		dst->files[fd] = file_duplicate_once (file);
+	else
+		dst->files[fd] = file_duplicate (file);
+	return dst->files[fd] != NULL;
+}
+
+/* for_each_fd() function for fd_table_copy(): undoes
+ * file_duplicate_once() for the file of T at FD. */
+static bool
+forget_fd (const struct fd_table *t, int fd, void *aux UNUSED) {
+	file_forget_duplicate (t->files[fd]);
+	return true;
+}
+
+/* Initializes DST as a copy of SRC, in which each open file of SRC is
+ * duplicated, so that the two processes keep separate file positions.
+ * Descriptors that share a file in SRC share its duplicate in DST.
+ * Takes time linear in the number of open descriptors, apart from
+ * copying the map.  Returns false if memory runs out. */
+bool
+fd_table_copy (struct fd_table *dst, const struct fd_table *src) {
+	bool success;
+
+	dst->files = calloc (src->size, sizeof *dst->files);
+	dst->map = malloc (FD_WORD (src->size) * sizeof *dst->map);
+	dst->size = src->size;
+	if (dst->files == NULL || dst->map == NULL) {
+		free (dst->files);
+		free (dst->map);
+		dst->files = NULL;
+		return false;
+	}
+	memcpy (dst->map, src->map, FD_WORD (src->size) * sizeof *dst->map);
+	dst->summary = src->summary;
+
+	success = for_each_fd (src, copy_fd, dst);
+	for_each_fd (src, forget_fd, NULL);
+	if (!success)
+		fd_table_destroy (dst);
+	return success;
+}
+
+/* Closes every file open in T and frees T's memory.  Does nothing if T
+ * was never initialized. */
+void
+fd_table_destroy (struct fd_table *t) {
+	if (t->files == NULL)
+		return;
+	for (int fd = 0; fd < t->size; fd++)
+		file_close (t->files[fd]);
+	free (t->files);
+	free (t->map);
+	t->files = NULL;
+}
+
+/* Returns the file open as FD in T, or a null pointer if there is
+ * none. */
+struct file *
+fd_table_get (const struct fd_table *t, int fd) {
+	if (fd < 0 || fd >= t->size)
+		return NULL;
+	return t->files[fd];
+}
+
+/* Installs FILE in the lowest free descriptor of T.  Returns the
+ * descriptor, or -1 if FILE is null, T is full or memory runs out. */
+int
+fd_table_install (struct fd_table *t, struct file *file) {
+	int fd = lowest_free (t);
+
+	if (file == NULL || fd < 0 || !grow (t, fd))
+		return -1;
+	t->files[fd] = file;
+	mark_used (t, fd);
+	return fd;
+}
+
+/* Makes NEWFD in T refer to the file open as OLDFD, sharing its file
+ * position, after closing the file that NEWFD referred to, if any.
+ * Returns NEWFD, or -1 if OLDFD is not open, NEWFD is out of range or
+ * memory runs out. */
+int
+fd_table_dup2 (struct fd_table *t, int oldfd, int newfd) {
+	struct file *file = fd_table_get (t, oldfd);
+	struct file *old;
+
+	if (file == NULL || newfd < 0 || newfd >= FD_MAX || !grow (t, newfd))
+		return -1;
+	if (newfd == oldfd)
+		return newfd;
+	old = t->files[newfd];
+	t->files[newfd] = file_share (file);
+	mark_used (t, newfd);
+	file_close (old);
+	return newfd;
+}
+
+/* Frees FD in T and returns the file that was open as FD, for the
+ * caller to close, or a null pointer if there was none. */
+struct file *
+fd_table_remove (struct fd_table *t, int fd) {
+	struct file *file = fd_table_get (t, fd);
+
+	if (file != NULL) {
+		t->files[fd] = NULL;
+		mark_free (t, fd);
+	}
+	return file;
+}
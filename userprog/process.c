@@ -2,6 +2,7 @@
 #include <debug.h>
 #include <inttypes.h>
 #include <round.h>
+#include <spawn.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -10,27 +11,66 @@
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
+#include "filesys/inode.h"
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
 #include "threads/vaddr.h"
+#include "userprog/syscall.h"
+#include "userprog/uaccess.h"
 #include "intrinsic.h"
 #ifdef VM
 #include "vm/vm.h"
 #endif
 
+/* A child process, as seen by its parent.  The record is shared by
+ * the two and freed when both are done with it, so that the parent can
+ * collect the exit status of a child that has already died, and a child
+ * can outlive its parent. */
+struct child {
+	tid_t tid;                  /* Child's thread identifier. */
+	int exit_status;            /* Valid once EXITED is raised. */
+	struct semaphore exited;    /* Raised when the child exits. */
+	int ref_cnt;                /* Parent and child, while alive. */
+	struct list_elem elem;      /* Element in the parent's children. */
+};
+
+/* Handed by a process to a thread that it starts.  The process waits
+ * until the new thread is done with it, so it can live on its stack. */
+struct process_start {
+	struct thread *parent;      /* Starting process. */
+	void *aux;                  /* initd's command line, the parent's
+	                               user context for fork, or the
+	                               spawn_args of spawn. */
+	struct child *child;        /* Record shared with the parent. */
+	struct semaphore started;   /* Raised once the thread is done with
+	                               this structure. */
+	bool success;               /* Whether fork duplicated the parent,
+	                               or spawn loaded the executable. */
+};
+
 static void process_cleanup (void);
-static bool load (const char *file_name, struct intr_frame *if_);
-static void initd (void *f_name);
+static bool load (char *cmd_line, struct intr_frame *if_);
+static void initd (void *start_);
 static void __do_fork (void *);
+static void __do_spawn (void *);
+static tid_t start_process (const char *name, thread_func *function,
+		struct process_start *start);
+static void child_put (struct child *child);
 
-/* General process initializer for initd and other process. */
-static void
+/* General process initializer for initd.  Forked and spawned processes
+ * start from a copy of their parent's descriptor table instead. */
+static bool
 process_init (void) {
 	struct thread *current = thread_current ();
+
+	current->exit_status = -1;
+	return fd_table_init (&current->fds);
 }
 
 /* Starts the first userland program, called "initd", loaded from FILE_NAME.
@@ -40,6 +80,8 @@ process_init (void) {
  * Notice that THIS SHOULD BE CALLED ONCE. */
 tid_t
 process_create_initd (const char *file_name) {
+	struct process_start start;
+	char name[16];
 	char *fn_copy;
 	tid_t tid;
 
@@ -50,8 +92,14 @@ process_create_initd (const char *file_name) {
 		return TID_ERROR;
 	strlcpy (fn_copy, file_name, PGSIZE);
 
+	/* The thread is named after the program, without its arguments. */
+	file_name += strspn (file_name, " ");
+	strlcpy (name, file_name, sizeof name);
+	name[strcspn (name, " ")] = '\0';
+
 	/* Create a new thread to execute FILE_NAME. */
-	tid = thread_create (file_name, PRI_DEFAULT, initd, fn_copy);
+	start.aux = fn_copy;
+	tid = start_process (name, initd, &start);
 	if (tid == TID_ERROR)
 		palloc_free_page (fn_copy);
 	return tid;
@@ -59,12 +107,18 @@ process_create_initd (const char *file_name) {
 
 /* A thread function that launches first user process. */
 static void
-initd (void *f_name) {
+initd (void *start_) {
+	struct process_start *start = start_;
+	char *f_name = start->aux;
+
+	thread_current ()->child = start->child;
 #ifdef VM
 	supplemental_page_table_init (&thread_current ()->spt);
 #endif
 
-	process_init ();
+	if (!process_init ())
+		PANIC ("Fail to launch initd\n");
+	sema_up (&start->started);
 
 	if (process_exec (f_name) < 0)
 		PANIC("Fail to launch initd\n");
@@ -74,10 +128,147 @@ initd (void *f_name) {
 /* Clones the current process as `name`. Returns the new process's thread id, or
  * TID_ERROR if the thread cannot be created. */
 tid_t
-process_fork (const char *name, struct intr_frame *if_ UNUSED) {
+process_fork (const char *name, struct intr_frame *if_) {
+	struct process_start start;
+	tid_t tid;
+
 	/* Clone current thread to new thread.*/
-	return thread_create (name,
-			PRI_DEFAULT, __do_fork, thread_current ());
+	start.aux = if_;
+	tid = start_process (name, __do_fork, &start);
+	if (tid != TID_ERROR && !start.success) {
+		list_remove (&start.child->elem);
+		child_put (start.child);
+		tid = TID_ERROR;
+	}
+	return tid;
+}
+
+/* What spawn() hands over to the new process. */
+struct spawn_args {
+	char *cmd_line;                         /* Command line to load. */
+	const struct spawn_fd_action *actions;  /* Descriptor actions. */
+	int action_cnt;                         /* Number of ACTIONS. */
+};
+
+/* Returns true if the ACTION_CNT ACTIONS can be applied, in order, to a
+ * copy of the descriptors in FDS: each has a known type and acts on a
+ * descriptor that is open by then, and each SPAWN_DUP2 targets a
+ * descriptor in range. */
+static bool
+spawn_actions_valid (const struct fd_table *fds,
+		const struct spawn_fd_action *actions, int action_cnt) {
+	/* Descriptors opened or closed by the actions so far. */
+	struct {
+		int fd;
+		bool open;
+	} changed[SPAWN_MAX_ACTIONS];
+	int changed_cnt = 0;
+
+	ASSERT (action_cnt <= SPAWN_MAX_ACTIONS);
+
+	for (int i = 0; i < action_cnt; i++) {
+		const struct spawn_fd_action *a = &actions[i];
+		bool open = fd_table_get (fds, a->fd) != NULL;
+
+		for (int j = changed_cnt - 1; j >= 0; j--)
+			if (changed[j].fd == a->fd) {
+				open = changed[j].open;
+				break;
+			}
+		if (!open)
+			return false;
+
+		switch (a->type) {
+			case SPAWN_DUP2:
+				if (a->newfd < 0 || a->newfd >= FD_MAX)
+					return false;
+				changed[changed_cnt].fd = a->newfd;
+				changed[changed_cnt++].open = true;
+				break;
+			case SPAWN_CLOSE:
+				changed[changed_cnt].fd = a->fd;
+				changed[changed_cnt++].open = false;
+				break;
+			default:
+				return false;
+		}
+	}
+	return true;
+}
+
+/* Starts a process named NAME that runs CMD_LINE, a page that is freed
+ * before returning, as a child of the current process.  Unlike fork
+ * followed by exec, the parent's memory is never copied: the child
+ * starts with an empty address space and loads the executable directly.
+ * The child's descriptors are copies of the parent's, changed by the
+ * ACTION_CNT ACTIONS.  Returns the new process's thread id, or TID_ERROR
+ * if an action is invalid, in which case no child is created, or if the
+ * child cannot be created or the executable cannot be loaded. */
+tid_t
+process_spawn (const char *name, char *cmd_line,
+		const struct spawn_fd_action *actions, int action_cnt) {
+	struct spawn_args args = {
+		.cmd_line = cmd_line,
+		.actions = actions,
+		.action_cnt = action_cnt,
+	};
+	struct process_start start;
+	tid_t tid;
+
+	if (!spawn_actions_valid (&thread_current ()->fds, actions,
+				action_cnt)) {
+		palloc_free_page (cmd_line);
+		return TID_ERROR;
+	}
+
+	start.aux = &args;
+	tid = start_process (name, __do_spawn, &start);
+	if (tid != TID_ERROR && !start.success) {
+		list_remove (&start.child->elem);
+		child_put (start.child);
+		tid = TID_ERROR;
+	}
+	palloc_free_page (cmd_line);
+	return tid;
+}
+
+/* Starts a thread named NAME that runs FUNCTION with START, as a child of
+ * the current thread, and waits until the new thread is done with START.
+ * Returns the new thread's id, or TID_ERROR if it cannot be created. */
+static tid_t
+start_process (const char *name, thread_func *function,
+		struct process_start *start) {
+	struct thread *curr = thread_current ();
+	struct child *child = malloc (sizeof *child);
+	tid_t tid;
+
+	if (child == NULL)
+		return TID_ERROR;
+	child->exit_status = -1;
+	child->ref_cnt = 2;
+	sema_init (&child->exited, 0);
+
+	start->parent = curr;
+	start->child = child;
+	start->success = false;
+	sema_init (&start->started, 0);
+
+	tid = thread_create (name, PRI_DEFAULT, function, start);
+	if (tid == TID_ERROR) {
+		free (child);
+		return TID_ERROR;
+	}
+	child->tid = tid;
+	list_push_back (&curr->children, &child->elem);
+	sema_down (&start->started);
+	return tid;
+}
+
+/* Drops a reference to CHILD, freeing it with the last one. */
+static void
+child_put (struct child *child) {
+	if (__atomic_sub_fetch (&child->ref_cnt, 1, __ATOMIC_ACQ_REL) == 0)
+		free (child);
 }
 
 #ifndef VM
@@ -91,42 +282,51 @@ duplicate_pte (uint64_t *pte, void *va, void *aux) {
 	void *newpage;
 	bool writable;
 
-	/* 1. TODO: If the parent_page is kernel page, then return immediately. */
+	/* 1. Kernel pages are shared by every page map level 4. */
+	if (is_kernel_vaddr (va))
+		return true;
 
 	/* 2. Resolve VA from the parent's page map level 4. */
 	parent_page = pml4_get_page (parent->pml4, va);
 
-	/* 3. TODO: Allocate new PAL_USER page for the child and set result to
-	 *    TODO: NEWPAGE. */
+	/* 3. Allocate new PAL_USER page for the child. */
+	newpage = palloc_get_page (PAL_USER);
+	if (newpage == NULL)
+		return false;
 
-	/* 4. TODO: Duplicate parent's page to the new page and
-	 *    TODO: check whether parent's page is writable or not (set WRITABLE
-	 *    TODO: according to the result). */
+	/* 4. Duplicate parent's page to the new page, with the same
+	 *    permission. */
+	memcpy (newpage, parent_page, PGSIZE);
+	writable = is_writable (pte);
 
 	/* 5. Add new page to child's page table at address VA with WRITABLE
 	 *    permission. */
 	if (!pml4_set_page (current->pml4, va, newpage, writable)) {
-		/* 6. TODO: if fail to insert page, do error handling. */
+		palloc_free_page (newpage);
+		return false;
 	}
 	return true;
 }
 #endif
 
-/* A thread function that copies parent's execution context.
- * Hint) parent->tf does not hold the userland context of the process.
- *       That is, you are required to pass second argument of process_fork to
- *       this function. */
+/* A thread function that copies parent's execution context.  parent->tf
+ * does not hold the userland context of the process, so process_fork()
+ * hands over its intr_frame in the process_start. */
 static void
 __do_fork (void *aux) {
 	struct intr_frame if_;
-	struct thread *parent = (struct thread *) aux;
+	struct process_start *start = aux;
+	struct thread *parent = start->parent;
 	struct thread *current = thread_current ();
-	/* TODO: somehow pass the parent_if. (i.e. process_fork()'s if_) */
-	struct intr_frame *parent_if;
+	struct intr_frame *parent_if = start->aux;
 	bool succ = true;
 
-	/* 1. Read the cpu context to local stack. */
+	current->child = start->child;
+
+	/* 1. Read the cpu context to local stack.  The child sees fork()
+	 *    return 0. */
 	memcpy (&if_, parent_if, sizeof (struct intr_frame));
+	if_.R.rax = 0;
 
 	/* 2. Duplicate PT */
 	current->pml4 = pml4_create();
@@ -143,18 +343,97 @@ __do_fork (void *aux) {
 		goto error;
 #endif
 
-	/* TODO: Your code goes here.
-	 * TODO: Hint) To duplicate the file object, use `file_duplicate`
-	 * TODO:       in include/filesys/file.h. Note that parent should not return
-	 * TODO:       from the fork() until this function successfully duplicates
-	 * TODO:       the resources of parent.*/
+#ifdef VM
+	current->user_rsp = parent->user_rsp;
+#endif
 
-	process_init ();
+	/* 3. Duplicate the open files.  The parent waits for us, so its
+	 *    descriptor table cannot change underneath. */
+	current->exit_status = -1;
+	lock_acquire (&filesys_lock);
+	succ = fd_table_copy (&current->fds, &parent->fds);
+	if (succ && parent->exec_file != NULL) {
+		current->exec_file = file_duplicate (parent->exec_file);
+		succ = current->exec_file != NULL;
+	}
+	lock_release (&filesys_lock);
+	if (!succ)
+		goto error;
 
-	/* Finally, switch to the newly created process. */
-	if (succ)
-		do_iret (&if_);
+	/* Finally, let the parent return and switch to the newly created
+	 * process. */
+	start->success = true;
+	sema_up (&start->started);
+	do_iret (&if_);
 error:
+	sema_up (&start->started);
+	thread_exit ();
+}
+
+/* Sets up the descriptors of a spawned process from those of PARENT
+ * and the ACTION_CNT ACTIONS, which process_spawn() has checked.
+ * Returns false if memory runs out. */
+static bool
+spawn_fds (struct thread *parent, const struct spawn_fd_action *actions,
+		int action_cnt) {
+	struct fd_table *fds = &thread_current ()->fds;
+
+	if (!fd_table_copy (fds, &parent->fds))
+		return false;
+
+	for (int i = 0; i < action_cnt; i++) {
+		const struct spawn_fd_action *a = &actions[i];
+
+		switch (a->type) {
+			case SPAWN_DUP2:
+				if (fd_table_dup2 (fds, a->fd, a->newfd) < 0)
+					return false;
+				break;
+			case SPAWN_CLOSE:
+				if (fd_table_get (fds, a->fd) == NULL)
+					return false;
+				file_close (fd_table_remove (fds, a->fd));
+				break;
+			default:
+				return false;
+		}
+	}
+	return true;
+}
+
+/* A thread function that starts a process for process_spawn(). */
+static void
+__do_spawn (void *start_) {
+	struct process_start *start = start_;
+	struct spawn_args *args = start->aux;
+	struct thread *current = thread_current ();
+	struct intr_frame _if;
+	bool success;
+
+	_if.ds = _if.es = _if.ss = SEL_UDSEG;
+	_if.cs = SEL_UCSEG;
+	_if.eflags = FLAG_IF | FLAG_MBS;
+
+	current->child = start->child;
+	current->exit_status = -1;
+#ifdef VM
+	supplemental_page_table_init (&current->spt);
+#endif
+
+	/* The parent waits for us, so its descriptor table cannot change
+	 * underneath. */
+	lock_acquire (&filesys_lock);
+	success = spawn_fds (start->parent, args->actions, args->action_cnt)
+		&& load (args->cmd_line, &_if);
+	lock_release (&filesys_lock);
+	if (!success)
+		goto error;
+
+	start->success = true;
+	sema_up (&start->started);
+	do_iret (&_if);
+error:
+	sema_up (&start->started);
 	thread_exit ();
 }
 
@@ -177,7 +456,9 @@ process_exec (void *f_name) {
 	process_cleanup ();
 
 	/* And then load the binary */
+	lock_acquire (&filesys_lock);
 	success = load (file_name, &_if);
+	lock_release (&filesys_lock);
 
 	/* If load failed, quit. */
 	palloc_free_page (file_name);
@@ -195,15 +476,25 @@ process_exec (void *f_name) {
  * exception), returns -1.  If TID is invalid or if it was not a
  * child of the calling process, or if process_wait() has already
  * been successfully called for the given TID, returns -1
- * immediately, without waiting.
- *
- * This function will be implemented in problem 2-2.  For now, it
- * does nothing. */
+ * immediately, without waiting. */
 int
-process_wait (tid_t child_tid UNUSED) {
-	/* XXX: Hint) The pintos exit if process_wait (initd), we recommend you
-	 * XXX:       to add infinite loop here before
-	 * XXX:       implementing the process_wait. */
+process_wait (tid_t child_tid) {
+	struct thread *curr = thread_current ();
+	struct list_elem *e;
+
+	for (e = list_begin (&curr->children); e != list_end (&curr->children);
+			e = list_next (e)) {
+		struct child *child = list_entry (e, struct child, elem);
+		int status;
+
+		if (child->tid != child_tid)
+			continue;
+		list_remove (e);
+		sema_down (&child->exited);
+		status = child->exit_status;
+		child_put (child);
+		return status;
+	}
 	return -1;
 }
 
@@ -211,12 +502,27 @@ process_wait (tid_t child_tid UNUSED) {
 void
 process_exit (void) {
 	struct thread *curr = thread_current ();
-	/* TODO: Your code goes here.
-	 * TODO: Implement process termination message (see
-	 * TODO: project2/process_termination.html).
-	 * TODO: We recommend you to implement process resource cleanup here. */
 
+	if (curr->child != NULL)
+		printf ("%s: exit(%d)\n", curr->name, curr->exit_status);
+
+	if (curr->fds.files != NULL) {
+		lock_acquire (&filesys_lock);
+		fd_table_destroy (&curr->fds);
+		lock_release (&filesys_lock);
+	}
 	process_cleanup ();
+
+	/* Orphan the children, then report to the parent. */
+	while (!list_empty (&curr->children))
+		child_put (list_entry (list_pop_front (&curr->children),
+					struct child, elem));
+	if (curr->child != NULL) {
+		curr->child->exit_status = curr->exit_status;
+		sema_up (&curr->child->exited);
+		child_put (curr->child);
+		curr->child = NULL;
+	}
 }
 
 /* Free the current process's resources. */
@@ -228,6 +534,13 @@ process_cleanup (void) {
 	supplemental_page_table_kill (&curr->spt);
 #endif
 
+	if (curr->exec_file != NULL) {
+		lock_acquire (&filesys_lock);
+		file_close (curr->exec_file);
+		lock_release (&filesys_lock);
+		curr->exec_file = NULL;
+	}
+
 	uint64_t *pml4;
 	/* Destroy the current process's page directory and switch back
 	 * to the kernel-only page directory. */
@@ -316,32 +629,36 @@ static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,
 		uint32_t read_bytes, uint32_t zero_bytes,
 		bool writable);
 
-/* Loads an ELF executable from FILE_NAME into the current thread.
- * Stores the executable's entry point into *RIP
- * and its initial stack pointer into *RSP.
- * Returns true if successful, false otherwise. */
-static bool
-load (const char *file_name, struct intr_frame *if_) {
-	struct thread *t = thread_current ();
+/* A loadable segment of an executable, as load_segment() takes it. */
+struct exec_segment {
+	uint64_t file_page;         /* Offset of the first page in the file. */
+	uint64_t mem_page;          /* User virtual address of the first page. */
+	uint32_t read_bytes;        /* Bytes to read from the file. */
+	uint32_t zero_bytes;        /* Bytes to zero after them. */
+	bool writable;              /* Whether the pages are writable. */
+};
+
+/* What load() needs of a validated executable.  It is cached with the
+ * executable's inode, so that executing the same file again while the
+ * inode is open, for example by a process still running it, skips
+ * reading and checking the headers.  It goes with the inode's last
+ * close, or with the first write to the file. */
+struct exec_image {
+	uint64_t entry;             /* Entry point. */
+	int seg_cnt;                /* Number of SEGS. */
+	struct exec_segment segs[]; /* PT_LOAD segments, in file order. */
+};
+
+/* Reads and validates the ELF headers of FILE, named FILE_NAME, and
+ * returns the image that they describe, allocated with malloc().
+ * Returns a null pointer if FILE is not a valid executable. */
+static struct exec_image *
+exec_image_parse (const char *file_name, struct file *file) {
+	struct exec_image *image = NULL;
 	struct ELF ehdr;
-	struct file *file = NULL;
 	off_t file_ofs;
-	bool success = false;
 	int i;
 
-	/* Allocate and activate page directory. */
-	t->pml4 = pml4_create ();
-	if (t->pml4 == NULL)
-		goto done;
-	process_activate (thread_current ());
-
-	/* Open executable file. */
-	file = filesys_open (file_name);
-	if (file == NULL) {
-		printf ("load: %s: open failed\n", file_name);
-		goto done;
-	}
-
 	/* Read and verify executable header. */
 	if (file_read (file, &ehdr, sizeof ehdr) != sizeof ehdr
 			|| memcmp (ehdr.e_ident, "\177ELF\2\1\1", 7)
@@ -351,8 +668,13 @@ load (const char *file_name, struct intr_frame *if_) {
 			|| ehdr.e_phentsize != sizeof (struct Phdr)
 			|| ehdr.e_phnum > 1024) {
 		printf ("load: %s: error loading executable\n", file_name);
-		goto done;
+		goto error;
 	}
+	image = malloc (sizeof *image + ehdr.e_phnum * sizeof *image->segs);
+	if (image == NULL)
+		goto error;
+	image->entry = ehdr.e_entry;
+	image->seg_cnt = 0;
 
 	/* Read program headers. */
 	file_ofs = ehdr.e_phoff;
@@ -360,11 +682,11 @@ load (const char *file_name, struct intr_frame *if_) {
 		struct Phdr phdr;
 
 		if (file_ofs < 0 || file_ofs > file_length (file))
-			goto done;
+			goto error;
 		file_seek (file, file_ofs);
 
 		if (file_read (file, &phdr, sizeof phdr) != sizeof phdr)
-			goto done;
+			goto error;
 		file_ofs += sizeof phdr;
 		switch (phdr.p_type) {
 			case PT_NULL:
@@ -377,51 +699,193 @@ load (const char *file_name, struct intr_frame *if_) {
 			case PT_DYNAMIC:
 			case PT_INTERP:
 			case PT_SHLIB:
-				goto done;
+				goto error;
 			case PT_LOAD:
 				if (validate_segment (&phdr, file)) {
-					bool writable = (phdr.p_flags & PF_W) != 0;
-					uint64_t file_page = phdr.p_offset & ~PGMASK;
-					uint64_t mem_page = phdr.p_vaddr & ~PGMASK;
+					struct exec_segment *seg = &image->segs[image->seg_cnt++];
 					uint64_t page_offset = phdr.p_vaddr & PGMASK;
-					uint32_t read_bytes, zero_bytes;
+
+					seg->writable = (phdr.p_flags & PF_W) != 0;
+					seg->file_page = phdr.p_offset & ~PGMASK;
+					seg->mem_page = phdr.p_vaddr & ~PGMASK;
 					if (phdr.p_filesz > 0) {
 						/* Normal segment.
 						 * Read initial part from disk and zero the rest. */
-						read_bytes = page_offset + phdr.p_filesz;
-						zero_bytes = (ROUND_UP (page_offset + phdr.p_memsz, PGSIZE)
-								- read_bytes);
+						seg->read_bytes = page_offset + phdr.p_filesz;
+						seg->zero_bytes = (ROUND_UP (page_offset + phdr.p_memsz, PGSIZE)
+								- seg->read_bytes);
 					} else {
 						/* Entirely zero.
 						 * Don't read anything from disk. */
-						read_bytes = 0;
-						zero_bytes = ROUND_UP (page_offset + phdr.p_memsz, PGSIZE);
+						seg->read_bytes = 0;
+						seg->zero_bytes = ROUND_UP (page_offset + phdr.p_memsz, PGSIZE);
 					}
-					if (!load_segment (file, file_page, (void *) mem_page,
-								read_bytes, zero_bytes, writable))
-						goto done;
 				}
 				else
-					goto done;
+					goto error;
 				break;
 		}
 	}
+	return image;
+
+error:
+	free (image);
+	return NULL;
+}
+
+/* The initial contents of a user stack, built by build_args(). */
+struct user_args {
+	int argc;                   /* Number of arguments. */
+	const char *argv0;          /* First argument, the program name. */
+	const void *image;          /* Bytes for the top of the stack. */
+	size_t size;                /* Size of IMAGE. */
+};
+
+/* Splits the command line in CMD_LINE, a page, into arguments at
+ * spaces and lays out, in the same page, the bytes that the top of the
+ * user stack starts with.  From the top down:
+ *
+ *   - the arguments, each followed by a null terminator;
+ *   - padding, so that the stack pointer is 16-byte aligned when the
+ *     program's entry point starts executing, as after a call;
+ *   - argv[0] through argv[argc - 1], then a null pointer;
+ *   - an empty environment, that is, a single null pointer;
+ *   - a fake return address.
+ *
+ * Everything is built in place, without another buffer: the arguments
+ * are packed to the start of the page, moved to its end, and the rest
+ * is written below them.  The result can then be copied to the stack in
+ * one piece.  Fills in *ARGS and returns true if successful, false if
+ * the command line is empty or the stack contents do not fit in a
+ * page. */
+static bool
+build_args (char *cmd_line, struct user_args *args) {
+	uint64_t *ptrs;
+	char *strs, *end, *w, *r;
+	size_t strs_size, ptrs_size, pad;
+	int argc = 0;
+
+	/* Pack the arguments to the start of the page, squeezing out the
+	 * spaces between them.  W never passes R. */
+	for (w = r = cmd_line; ; argc++) {
+		r += strspn (r, " ");
+		if (*r == '\0')
+			break;
+		while (*r != ' ' && *r != '\0')
+			*w++ = *r++;
+		*w++ = '\0';
+	}
+	if (argc == 0)
+		return false;
+	strs_size = w - cmd_line;
+	ptrs_size = (argc + 2) * sizeof *ptrs;
+	pad = (16 - (strs_size + ptrs_size) % 16) % 16;
+	args->size = strs_size + pad + ptrs_size + sizeof *ptrs;
+	if (args->size > PGSIZE)
+		return false;
+
+	/* Move the arguments to the end of the page, then fill in the rest
+	 * below them. */
+	end = cmd_line + PGSIZE;
+	strs = memmove (end - strs_size, cmd_line, strs_size);
+	ptrs = (uint64_t *) (strs - pad) - (argc + 2);
+	memset (strs - pad, 0, pad);
+	for (int i = 0; i < argc; i++) {
+		ptrs[i] = USER_STACK - (end - strs);
+		strs += strlen (strs) + 1;
+	}
+	ptrs[argc] = 0;
+	ptrs[argc + 1] = 0;
+	ptrs[-1] = 0;
+
+	args->argc = argc;
+	args->argv0 = end - strs_size;
+	args->image = ptrs - 1;
+	return true;
+}
+
+/* Loads the ELF executable named by the first word of CMD_LINE, a page
+ * that this function overwrites, into the current thread, with the
+ * words as its arguments.
+ * Stores the executable's entry point into *RIP
+ * and its initial stack pointer into *RSP.
+ * Returns true if successful, false otherwise.
+ * Must be called with filesys_lock held. */
+static bool
+load (char *cmd_line, struct intr_frame *if_) {
+	struct thread *t = thread_current ();
+	struct exec_image *image = NULL;
+	bool image_cached = false;
+	struct user_args args;
+	const char *file_name;
+	struct file *file = NULL;
+	struct inode *inode;
+	bool success = false;
+	int i;
+
+	if (!build_args (cmd_line, &args))
+		return false;
+	file_name = args.argv0;
+
+	/* Allocate and activate page directory. */
+	t->pml4 = pml4_create ();
+	if (t->pml4 == NULL)
+		goto done;
+	process_activate (thread_current ());
+
+	/* Open executable file. */
+	file = filesys_open (file_name);
+	if (file == NULL) {
+		printf ("load: %s: open failed\n", file_name);
+		goto done;
+	}
+
+	/* Parse the headers, unless the image is cached. */
+	inode = file_get_inode (file);
+	image = inode_get_exec_image (inode);
+	image_cached = image != NULL;
+	if (!image_cached) {
+		image = exec_image_parse (file_name, file);
+		if (image == NULL)
+			goto done;
+		image_cached = inode_set_exec_image (inode, image);
+	}
+
+	for (i = 0; i < image->seg_cnt; i++) {
+		const struct exec_segment *seg = &image->segs[i];
+
+		if (!load_segment (file, seg->file_page, (void *) seg->mem_page,
+					seg->read_bytes, seg->zero_bytes, seg->writable))
+			goto done;
+	}
 
 	/* Set up stack. */
 	if (!setup_stack (if_))
 		goto done;
 
 	/* Start address. */
-	if_->rip = ehdr.e_entry;
+	if_->rip = image->entry;
 
-	/* TODO: Your code goes here.
-	 * TODO: Implement argument passing (see project2/argument_passing.html). */
+	/* Arguments.  The entry point receives argc and argv like main(). */
+	if_->rsp = USER_STACK - args.size;
+	if (copy_to_user ((void *) if_->rsp, args.image, args.size) != 0)
+		goto done;
+	if_->R.rdi = args.argc;
+	if_->R.rsi = if_->rsp + sizeof (uint64_t);
 
 	success = true;
 
 done:
-	/* We arrive here whether the load is successful or not. */
-	file_close (file);
+	/* We arrive here whether the load is successful or not.  The
+	 * executable of a running process stays open and cannot be
+	 * written. */
+	if (success) {
+		file_deny_write (file);
+		t->exec_file = file;
+	} else
+		file_close (file);
+	if (!image_cached)
+		free (image);
 	return success;
 }
 
@@ -576,9 +1040,14 @@ install_page (void *upage, void *kpage, bool writable) {
 
 static bool
 lazy_load_segment (struct page *page, void *aux) {
-	/* TODO: Load the segment from the file */
-	/* TODO: This called when the first page fault occurs on address VA. */
-	/* TODO: VA is available when calling this function. */
+	struct file_page *info = aux;
+	bool success;
+
+	/* The page is already zeroed, so only the file part is left. */
+	success = file_read_at (info->file, page->frame->kva, info->read_bytes,
+			info->offset) == (off_t) info->read_bytes;
+	file_page_free (info);
+	return success;
 }
 
 /* Loads a segment starting at offset OFS in FILE at address
@@ -609,15 +1078,27 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 		size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
 		size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
-		/* TODO: Set up aux to pass information to the lazy_load_segment. */
-		void *aux = NULL;
+		struct file_page *aux = malloc (sizeof *aux);
+		if (aux == NULL)
+			return false;
+		aux->file = file_reopen (file);
+		aux->offset = ofs;
+		aux->read_bytes = page_read_bytes;
+		aux->zero_bytes = page_zero_bytes;
+		if (aux->file == NULL) {
+			free (aux);
+			return false;
+		}
 		if (!vm_alloc_page_with_initializer (VM_ANON, upage,
-					writable, lazy_load_segment, aux))
+					writable, lazy_load_segment, aux)) {
+			file_page_free (aux);
 			return false;
+		}
 
 		/* Advance. */
 		read_bytes -= page_read_bytes;
 		zero_bytes -= page_zero_bytes;
+		ofs += page_read_bytes;
 		upage += PGSIZE;
 	}
 	return true;
@@ -629,11 +1110,11 @@ setup_stack (struct intr_frame *if_) {
 	bool success = false;
 	void *stack_bottom = (void *) (((uint8_t *) USER_STACK) - PGSIZE);
 
-	/* TODO: Map the stack on stack_bottom and claim the page immediately.
-	 * TODO: If success, set the rsp accordingly.
-	 * TODO: You should mark the page is stack. */
-	/* TODO: Your code goes here */
-
+	if (vm_alloc_page (VM_ANON | VM_STACK, stack_bottom, true)
+			&& vm_claim_page (stack_bottom)) {
+		if_->rsp = USER_STACK;
+		success = true;
+	}
 	return success;
 }
 #endif /* VM */
@@ -1,16 +1,102 @@
 #include "userprog/syscall.h"
+#include <iov.h>
+#include <iovec.h>
+#include <poll.h>
+#include <round.h>
+#include <spawn.h>
 #include <stdio.h>
+#include <string.h>
 #include <syscall-nr.h>
+#include "devices/input.h"
+#include "devices/timer.h"
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#include "filesys/pipe.h"
+#include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/loader.h"
+#include "threads/vaddr.h"
+#include "threads/wait.h"
 #include "userprog/gdt.h"
+#include "userprog/process.h"
+#include "userprog/uaccess.h"
 #include "threads/flags.h"
 #include "intrinsic.h"
 
+/* Size of the buffer that file names are copied into. */
+#define PATH_BUF_SIZE 128
+
+/* Largest part of the user buffers of a read or write that is pinned at
+ * once, so that one large transfer cannot pin most of the user pool. */
+#define PIN_CHUNK (16 * PGSIZE)
+
+/* Returned by user_transfer() if part of the user buffers is not
+ * mapped. */
+#define TRANSFER_FAULT (-2)
+
+/* Bytes of console output passed to the display at once. */
+#define CONSOLE_CHUNK 256
+
+/* A system call handler.  It takes its arguments from F's registers and
+ * returns its result, if any, in F->R.rax. */
+typedef void syscall_func (struct intr_frame *f);
+
 void syscall_entry (void);
 void syscall_handler (struct intr_frame *);
 
+static syscall_func sys_halt, sys_exit, sys_fork, sys_exec, sys_wait;
+static syscall_func sys_create, sys_remove, sys_open, sys_filesize;
+static syscall_func sys_read, sys_write, sys_seek, sys_tell, sys_close;
+static syscall_func sys_dup2;
+static syscall_func sys_readv, sys_writev, sys_pread, sys_pwrite;
+static syscall_func sys_copy_file_range, sys_spawn, sys_pipe, sys_poll;
+#ifdef VM
+static syscall_func sys_mmap, sys_munmap, sys_mmap_shared, sys_vmstat;
+static syscall_func sys_madvise, sys_mlock, sys_munlock;
+#endif
+
+/* System call handlers, indexed by system call number.  Numbers without
+ * a handler terminate the calling process. */
+static syscall_func *const syscall_table[] = {
+	[SYS_HALT] = sys_halt,
+	[SYS_EXIT] = sys_exit,
+	[SYS_FORK] = sys_fork,
+	[SYS_EXEC] = sys_exec,
+	[SYS_WAIT] = sys_wait,
+	[SYS_CREATE] = sys_create,
+	[SYS_REMOVE] = sys_remove,
+	[SYS_OPEN] = sys_open,
+	[SYS_FILESIZE] = sys_filesize,
+	[SYS_READ] = sys_read,
+	[SYS_WRITE] = sys_write,
+	[SYS_SEEK] = sys_seek,
+	[SYS_TELL] = sys_tell,
+	[SYS_CLOSE] = sys_close,
+	[SYS_DUP2] = sys_dup2,
+	[SYS_READV] = sys_readv,
+	[SYS_WRITEV] = sys_writev,
+	[SYS_PREAD] = sys_pread,
+	[SYS_PWRITE] = sys_pwrite,
+	[SYS_COPY_FILE_RANGE] = sys_copy_file_range,
+	[SYS_SPAWN] = sys_spawn,
+	[SYS_PIPE] = sys_pipe,
+	[SYS_POLL] = sys_poll,
+#ifdef VM
+	[SYS_MMAP] = sys_mmap,
+	[SYS_MUNMAP] = sys_munmap,
+	[SYS_MMAP_SHARED] = sys_mmap_shared,
+	[SYS_VMSTAT] = sys_vmstat,
+	[SYS_MADVISE] = sys_madvise,
+	[SYS_MLOCK] = sys_mlock,
+	[SYS_MUNLOCK] = sys_munlock,
+#endif
+};
+
+struct lock filesys_lock;
+
 /* System call.
  *
  * Previously system call services was handled by the interrupt handler
@@ -35,12 +121,817 @@ syscall_init (void) {
 	 * mode stack. Therefore, we masked the FLAG_FL. */
 	write_msr(MSR_SYSCALL_MASK,
 			FLAG_IF | FLAG_TF | FLAG_DF | FLAG_IOPL | FLAG_AC | FLAG_NT);
+
+	lock_init (&filesys_lock);
+}
+
+/* Terminates the current process with STATUS. */
+static void
+terminate (int status) {
+	thread_current ()->exit_status = status;
+	thread_exit ();
 }
 
 /* The main system call interface */
 void
-syscall_handler (struct intr_frame *f UNUSED) {
-	// TODO: Your implementation goes here.
-	printf ("system call!\n");
-	thread_exit ();
+syscall_handler (struct intr_frame *f) {
+	uint64_t nr = f->R.rax;
+
+#ifdef VM
+	/* Page faults in the kernel need it to recognize stack growth. */
+	thread_current ()->user_rsp = f->rsp;
+#endif
+	if (nr >= sizeof syscall_table / sizeof *syscall_table
+			|| syscall_table[nr] == NULL)
+		terminate (-1);
+	syscall_table[nr] (f);
+}
+
+/* Returns true if the SIZE bytes at UADDR lie in user address space.
+ * Whether they are mapped is only found out when they are pinned or
+ * accessed. */
+static bool
+user_range_valid (const void *uaddr, size_t size) {
+	const uint8_t *end = (const uint8_t *) uaddr + size;
+
+	return size == 0
+		|| (is_user_vaddr (uaddr) && end > (const uint8_t *) uaddr
+			&& is_user_vaddr (end - 1));
+}
+
+/* Terminates the process unless the SIZE bytes at UADDR lie in user
+ * address space. */
+static void
+check_user_buffer (const void *uaddr, size_t size) {
+	if (!user_range_valid (uaddr, size))
+		terminate (-1);
+}
+
+/* Copies the IOVCNT iovecs at user address UIOV into a new array, which
+ * the caller must free.  Returns a null pointer if IOVCNT is out of range
+ * or the buffers add up to more than a file can hold.  Terminates the
+ * process if the iovecs or their buffers are not in user memory. */
+static struct iovec *
+copy_user_iovec (const struct iovec *uiov, int iovcnt) {
+	struct iovec *iov;
+	size_t total = 0;
+
+	if (iovcnt <= 0 || iovcnt > IOV_MAX)
+		return NULL;
+	iov = malloc (iovcnt * sizeof *iov);
+	if (iov == NULL)
+		return NULL;
+	if (copy_from_user (iov, uiov, iovcnt * sizeof *iov) != 0) {
+		free (iov);
+		terminate (-1);
+	}
+	for (int i = 0; i < iovcnt; i++) {
+		if (!user_range_valid (iov[i].iov_base, iov[i].iov_len)) {
+			free (iov);
+			terminate (-1);
+		}
+		total += iov[i].iov_len;
+		if (iov[i].iov_len > INT32_MAX || total > INT32_MAX) {
+			free (iov);
+			return NULL;
+		}
+	}
+	return iov;
+}
+
+/* Returns the total size of the IOVCNT buffers in IOV. */
+static size_t
+iov_total (const struct iovec *iov, int iovcnt) {
+	size_t total = 0;
+
+	for (int i = 0; i < iovcnt; i++)
+		total += iov[i].iov_len;
+	return total;
+}
+
+/* Copies the file name at user address UPATH to PATH.  Returns false if
+ * it is too long, terminates the process if it is not in user memory. */
+static bool
+copy_user_path (char path[PATH_BUF_SIZE], const char *upath) {
+	int64_t len = strncpy_from_user (path, upath, PATH_BUF_SIZE);
+
+	if (len < 0)
+		terminate (-1);
+	return len < PATH_BUF_SIZE;
+}
+
+/* Returns the file open as FD in the current process, or a null pointer
+ * if there is none. */
+static struct file *
+fd_lookup (int fd) {
+	return fd_table_get (&thread_current ()->fds, fd);
+}
+
+/* Returns the file open as FD in the current process if it has an
+ * inode, for the calls that need a file position or length, or a null
+ * pointer if there is none or it is a pipe. */
+static struct file *
+fd_lookup_file (int fd) {
+	struct file *file = fd_lookup (fd);
+
+	return file != NULL && file_get_inode (file) != NULL ? file : NULL;
+}
+
+#ifdef VM
+/* Unpins the user memory behind SIZE bytes of the buffers in IOV,
+ * starting OFS bytes into the first, which pin_user_iov() pinned. */
+static void
+unpin_user_iov (const struct iovec *iov, size_t ofs, size_t size) {
+	for (; size > 0; iov++, ofs = 0) {
+		size_t n = iov->iov_len - ofs < size ? iov->iov_len - ofs : size;
+
+		vm_unpin_user ((uint8_t *) iov->iov_base + ofs, n);
+		size -= n;
+	}
+}
+
+/* Pins the user memory behind SIZE bytes of the buffers in IOV, starting
+ * OFS bytes into the first, writable if WRITE is true, so that it stays
+ * resident while it is copied with locks held.  Returns false, with
+ * nothing pinned, if it cannot be brought in. */
+static bool
+pin_user_iov (const struct iovec *iov, size_t ofs, size_t size, bool write) {
+	const struct iovec *first = iov;
+	size_t first_ofs = ofs;
+	size_t done = 0;
+
+	for (; done < size; iov++, ofs = 0) {
+		size_t n = iov->iov_len - ofs;
+
+		if (n > size - done)
+			n = size - done;
+		if (!vm_pin_user ((uint8_t *) iov->iov_base + ofs, n, write)) {
+			unpin_user_iov (first, first_ofs, done);
+			return false;
+		}
+		done += n;
+	}
+	return true;
+}
+#else
+/* Without VM, user pages never leave memory, so there is nothing to
+ * pin. */
+static void
+unpin_user_iov (const struct iovec *iov UNUSED, size_t ofs UNUSED,
+		size_t size UNUSED) {
+}
+
+/* Checks that the user memory behind SIZE bytes of the buffers in IOV,
+ * starting OFS bytes into the first, is mapped, and writable if WRITE is
+ * true, since it cannot go away afterwards. */
+static bool
+pin_user_iov (const struct iovec *iov, size_t ofs, size_t size, bool write) {
+	for (; size > 0; iov++, ofs = 0) {
+		size_t n = iov->iov_len - ofs < size ? iov->iov_len - ofs : size;
+
+		if (!probe_user ((uint8_t *) iov->iov_base + ofs, n, write))
+			return false;
+		size -= n;
+	}
+	return true;
+}
+#endif
+
+/* Reads SIZE keys from the keyboard into the buffers of IT.  Returns
+ * SIZE. */
+static off_t
+console_read (struct iov_iter *it, size_t size) {
+	for (size_t i = 0; i < size; i++) {
+		uint8_t key = input_getc ();
+
+		iov_iter_copy_to (it, &key, 1);
+	}
+	return size;
+}
+
+/* Writes SIZE bytes from the buffers of IT to the console's display.
+ * Returns SIZE. */
+static off_t
+console_write (struct iov_iter *it, size_t size) {
+	char chunk[CONSOLE_CHUNK];
+
+	for (size_t done = 0; done < size; ) {
+		size_t n = size - done < sizeof chunk ? size - done : sizeof chunk;
+
+		iov_iter_copy_from (it, chunk, n);
+		putbuf (chunk, n);
+		done += n;
+	}
+	return size;
+}
+
+/* Moves up to SIZE bytes between the user buffers of IT and FILE,
+ * writing to FILE if WRITE is true.  If FILE is an end of a pipe or the
+ * console, it must be the matching one.  Otherwise the transfer starts
+ * at *OFS, or at FILE's position, which it advances, if OFS is null.
+ *
+ * The buffers must lie in user address space.  They are pinned
+ * PIN_CHUNK bytes at a time while they are copied, so that eviction
+ * cannot take them away under filesys_lock or a pipe's lock.  Returns
+ * TRANSFER_FAULT, whatever was moved already, if part of them is not
+ * mapped.  Otherwise returns the number of bytes moved, or -1 if FILE is
+ * the wrong end of a pipe or of the console or nothing could be written
+ * to it.  Must be
+ * called without filesys_lock, as a pipe may wait for its other end. */
+static off_t
+user_transfer (struct file *file, struct iov_iter *it, size_t size,
+		const off_t *ofs, bool write) {
+	struct pipe *pipe = NULL;
+	bool console = file_is_console (file, write);
+	off_t pos = ofs != NULL ? *ofs : 0;
+	off_t done = 0, moved = 0;
+
+	if (file_get_inode (file) == NULL && !console
+			&& (pipe = file_get_pipe (file, write)) == NULL)
+		return -1;
+	if (size > INT32_MAX)
+		size = INT32_MAX;
+	while ((size_t) done < size) {
+		const struct iovec *iov = it->iov;
+		size_t iov_ofs = it->ofs;
+		size_t n = size - done < PIN_CHUNK ? size - done : PIN_CHUNK;
+
+		/* Reading from FILE writes to the buffers. */
+		if (!pin_user_iov (iov, iov_ofs, n, !write))
+			return TRANSFER_FAULT;
+		if (console)
+			moved = write ? console_write (it, n) : console_read (it, n);
+		else if (pipe != NULL)
+			moved = write ? pipe_write (pipe, it, n) : pipe_read (pipe, it, n);
+		else {
+			lock_acquire (&filesys_lock);
+			if (ofs != NULL)
+				moved = write ? file_write_iter_at (file, it, n, pos)
+					: file_read_iter_at (file, it, n, pos);
+			else
+				moved = write ? file_write_iter (file, it, n)
+					: file_read_iter (file, it, n);
+			lock_release (&filesys_lock);
+		}
+		unpin_user_iov (iov, iov_ofs, n);
+		if (moved <= 0)
+			break;
+		done += moved;
+		pos += moved;
+
+		/* A pipe read waits only for its first byte and then takes what
+		 * is there, at most a full ring, which is no more than a chunk.
+		 * Reading on could wait for data the caller did not wait for. */
+		if ((size_t) moved < n || (pipe != NULL && !write))
+			break;
+	}
+	return done > 0 ? done : moved;
+}
+
+/* Stores the result MOVED of user_transfer() as the return value of the
+ * system call in F, terminating the process if it faulted. */
+static void
+transfer_result (struct intr_frame *f, off_t moved) {
+	if (moved == TRANSFER_FAULT)
+		terminate (-1);
+	f->R.rax = moved;
+}
+
+/* Installs FILE in the lowest free descriptor of the current process.
+ * Returns the descriptor, or -1 if the table is full. */
+static int
+fd_install (struct file *file) {
+	return fd_table_install (&thread_current ()->fds, file);
+}
+
+static void
+sys_halt (struct intr_frame *f UNUSED) {
+	power_off ();
+}
+
+static void
+sys_exit (struct intr_frame *f) {
+	terminate (f->R.rdi);
+}
+
+static void
+sys_fork (struct intr_frame *f) {
+	char name[PATH_BUF_SIZE];
+
+	if (!copy_user_path (name, (const char *) f->R.rdi))
+		f->R.rax = TID_ERROR;
+	else
+		f->R.rax = process_fork (name, f);
+}
+
+/* Runs the command line at user address RDI in place of the current
+ * process.  Only returns if loading fails, and then terminates the
+ * process, as its address space is already gone. */
+static void
+sys_exec (struct intr_frame *f) {
+	char *cmd_line = palloc_get_page (0);
+	int64_t len;
+
+	if (cmd_line == NULL)
+		terminate (-1);
+	len = strncpy_from_user (cmd_line, (const char *) f->R.rdi, PGSIZE);
+	if (len < 0 || len == PGSIZE) {
+		palloc_free_page (cmd_line);
+		terminate (-1);
+	}
+	process_exec (cmd_line);
+	terminate (-1);
+}
+
+/* Builds a command line in CMD_LINE, a page, from the file name PATH
+ * followed by the user argument vector UARGV, which may be a null
+ * pointer.  UARGV[0] is skipped, as PATH takes its place.  Returns
+ * false if the command line does not fit, terminates the process if
+ * UARGV is not in user memory. */
+static bool
+build_cmd_line (char *cmd_line, const char *path, const char **uargv) {
+	size_t len = strlcpy (cmd_line, path, PGSIZE);
+
+	for (int i = 1; uargv != NULL; i++) {
+		const char *uarg;
+		int64_t arg_len;
+
+		if (copy_from_user (&uarg, &uargv[i], sizeof uarg) != 0) {
+			palloc_free_page (cmd_line);
+			terminate (-1);
+		}
+		if (uarg == NULL)
+			break;
+		if (len + 1 >= PGSIZE)
+			return false;
+		cmd_line[len++] = ' ';
+		arg_len = strncpy_from_user (cmd_line + len, uarg, PGSIZE - len);
+		if (arg_len < 0) {
+			palloc_free_page (cmd_line);
+			terminate (-1);
+		}
+		len += arg_len;
+		if (len == PGSIZE)
+			return false;
+	}
+	return true;
+}
+
+/* Starts the executable named by RDI as a child process, with the
+ * arguments in the null-terminated vector RSI and the descriptor actions
+ * at RDX, without duplicating the caller's address space as fork does.
+ * Returns the child's pid, or -1 on failure. */
+static void
+sys_spawn (struct intr_frame *f) {
+	const struct spawn_fd_action *uactions = (const void *) f->R.rdx;
+	struct spawn_fd_action actions[SPAWN_MAX_ACTIONS];
+	char path[PATH_BUF_SIZE];
+	char *cmd_line;
+	int cnt = 0;
+
+	f->R.rax = TID_ERROR;
+	if (!copy_user_path (path, (const char *) f->R.rdi))
+		return;
+	for (; uactions != NULL; cnt++) {
+		struct spawn_fd_action action;
+
+		if (copy_from_user (&action, &uactions[cnt], sizeof action) != 0)
+			terminate (-1);
+		if (action.type == SPAWN_END)
+			break;
+		if (cnt == SPAWN_MAX_ACTIONS)
+			return;
+		actions[cnt] = action;
+	}
+
+	cmd_line = palloc_get_page (0);
+	if (cmd_line == NULL)
+		return;
+	if (!build_cmd_line (cmd_line, path, (const char **) f->R.rsi)) {
+		palloc_free_page (cmd_line);
+		return;
+	}
+	f->R.rax = process_spawn (path, cmd_line, actions, cnt);
+}
+
+static void
+sys_wait (struct intr_frame *f) {
+	f->R.rax = process_wait (f->R.rdi);
+}
+
+static void
+sys_create (struct intr_frame *f) {
+	char path[PATH_BUF_SIZE];
+
+	f->R.rax = false;
+	if (copy_user_path (path, (const char *) f->R.rdi)) {
+		lock_acquire (&filesys_lock);
+		f->R.rax = filesys_create (path, f->R.rsi);
+		lock_release (&filesys_lock);
+	}
+}
+
+static void
+sys_remove (struct intr_frame *f) {
+	char path[PATH_BUF_SIZE];
+
+	f->R.rax = false;
+	if (copy_user_path (path, (const char *) f->R.rdi)) {
+		lock_acquire (&filesys_lock);
+		f->R.rax = filesys_remove (path);
+		lock_release (&filesys_lock);
+	}
+}
+
+static void
+sys_open (struct intr_frame *f) {
+	char path[PATH_BUF_SIZE];
+	struct file *file;
+	int fd = -1;
+
+	if (copy_user_path (path, (const char *) f->R.rdi)) {
+		lock_acquire (&filesys_lock);
+		file = filesys_open (path);
+		if (file != NULL && (fd = fd_install (file)) < 0)
+			file_close (file);
+		lock_release (&filesys_lock);
+	}
+	f->R.rax = fd;
+}
+
+static void
+sys_filesize (struct intr_frame *f) {
+	struct file *file = fd_lookup_file (f->R.rdi);
+
+	f->R.rax = -1;
+	if (file != NULL) {
+		lock_acquire (&filesys_lock);
+		f->R.rax = file_length (file);
+		lock_release (&filesys_lock);
+	}
+}
+
+static void
+sys_read (struct intr_frame *f) {
+	int fd = f->R.rdi;
+	uint8_t *buffer = (uint8_t *) f->R.rsi;
+	unsigned size = f->R.rdx;
+	struct file *file;
+
+	check_user_buffer (buffer, size);
+	if ((file = fd_lookup (fd)) != NULL) {
+		struct iov_iter it;
+
+		iov_iter_init_buf (&it, buffer, size);
+		transfer_result (f, user_transfer (file, &it, size, NULL, false));
+	} else
+		f->R.rax = -1;
+}
+
+static void
+sys_write (struct intr_frame *f) {
+	int fd = f->R.rdi;
+	const void *buffer = (const void *) f->R.rsi;
+	unsigned size = f->R.rdx;
+	struct file *file;
+
+	check_user_buffer (buffer, size);
+	if ((file = fd_lookup (fd)) != NULL) {
+		struct iov_iter it;
+
+		iov_iter_init_buf (&it, (void *) buffer, size);
+		transfer_result (f, user_transfer (file, &it, size, NULL, true));
+	} else
+		f->R.rax = -1;
+}
+
+/* Reads from RDI into the RDX buffers described by the iovecs at RSI,
+ * filling each buffer before the next. */
+static void
+sys_readv (struct intr_frame *f) {
+	int fd = f->R.rdi;
+	int iovcnt = f->R.rdx;
+	struct iovec *iov;
+	struct file *file;
+
+	f->R.rax = iovcnt == 0 ? 0 : -1;
+	iov = copy_user_iovec ((const struct iovec *) f->R.rsi, iovcnt);
+	if (iov == NULL)
+		return;
+	if ((file = fd_lookup (fd)) != NULL) {
+		struct iov_iter it;
+		off_t moved;
+
+		iov_iter_init (&it, iov, iovcnt);
+		moved = user_transfer (file, &it, iov_total (iov, iovcnt), NULL,
+				false);
+		free (iov);
+		transfer_result (f, moved);
+		return;
+	}
+	free (iov);
+}
+
+/* Writes the RDX buffers described by the iovecs at RSI to RDI, one after
+ * the other. */
+static void
+sys_writev (struct intr_frame *f) {
+	int fd = f->R.rdi;
+	int iovcnt = f->R.rdx;
+	struct iovec *iov;
+	struct file *file;
+
+	f->R.rax = iovcnt == 0 ? 0 : -1;
+	iov = copy_user_iovec ((const struct iovec *) f->R.rsi, iovcnt);
+	if (iov == NULL)
+		return;
+	if ((file = fd_lookup (fd)) != NULL) {
+		struct iov_iter it;
+		off_t moved;
+
+		iov_iter_init (&it, iov, iovcnt);
+		moved = user_transfer (file, &it, iov_total (iov, iovcnt), NULL,
+				true);
+		free (iov);
+		transfer_result (f, moved);
+		return;
+	}
+	free (iov);
+}
+
+/* Reads RDX bytes from RDI at file position R10 into RSI, without moving
+ * the file's position. */
+static void
+sys_pread (struct intr_frame *f) {
+	struct file *file = fd_lookup_file (f->R.rdi);
+	void *buffer = (void *) f->R.rsi;
+	unsigned size = f->R.rdx;
+	off_t offset = f->R.r10;
+
+	check_user_buffer (buffer, size);
+	f->R.rax = -1;
+	if (file != NULL && offset >= 0) {
+		struct iov_iter it;
+
+		iov_iter_init_buf (&it, buffer, size);
+		transfer_result (f, user_transfer (file, &it, size, &offset, false));
+	}
+}
+
+/* Writes RDX bytes from RSI to RDI at file position R10, without moving
+ * the file's position. */
+static void
+sys_pwrite (struct intr_frame *f) {
+	struct file *file = fd_lookup_file (f->R.rdi);
+	const void *buffer = (const void *) f->R.rsi;
+	unsigned size = f->R.rdx;
+	off_t offset = f->R.r10;
+
+	check_user_buffer (buffer, size);
+	f->R.rax = -1;
+	if (file != NULL && offset >= 0) {
+		struct iov_iter it;
+
+		iov_iter_init_buf (&it, (void *) buffer, size);
+		transfer_result (f, user_transfer (file, &it, size, &offset, true));
+	}
+}
+
+/* Copies RDX bytes from RDI to RSI, each at its file position, without
+ * passing them through user memory.  Overlapping ranges of one file are
+ * refused. */
+static void
+sys_copy_file_range (struct intr_frame *f) {
+	struct file *in = fd_lookup_file (f->R.rdi);
+	struct file *out = fd_lookup_file (f->R.rsi);
+	off_t size = f->R.rdx > INT32_MAX ? INT32_MAX : (off_t) f->R.rdx;
+
+	f->R.rax = -1;
+	if (in == NULL || out == NULL)
+		return;
+	lock_acquire (&filesys_lock);
+	if (file_get_inode (in) != file_get_inode (out)
+			|| (int64_t) file_tell (in) + size <= file_tell (out)
+			|| (int64_t) file_tell (out) + size <= file_tell (in))
+		f->R.rax = file_copy_range (out, in, size);
+	lock_release (&filesys_lock);
+}
+
+static void
+sys_seek (struct intr_frame *f) {
+	struct file *file = fd_lookup_file (f->R.rdi);
+
+	if (file != NULL) {
+		lock_acquire (&filesys_lock);
+		file_seek (file, f->R.rsi);
+		lock_release (&filesys_lock);
+	}
+}
+
+static void
+sys_tell (struct intr_frame *f) {
+	struct file *file = fd_lookup_file (f->R.rdi);
+
+	f->R.rax = -1;
+	if (file != NULL) {
+		lock_acquire (&filesys_lock);
+		f->R.rax = file_tell (file);
+		lock_release (&filesys_lock);
+	}
+}
+
+static void
+sys_close (struct intr_frame *f) {
+	struct file *file = fd_table_remove (&thread_current ()->fds, f->R.rdi);
+
+	if (file != NULL) {
+		lock_acquire (&filesys_lock);
+		file_close (file);
+		lock_release (&filesys_lock);
+	}
+}
+
+/* Makes descriptor RSI refer to the same file as RDI, sharing its file
+ * position, after closing what RSI referred to.  Returns RSI, or -1 if
+ * RDI is not open or RSI is out of range. */
+static void
+sys_dup2 (struct intr_frame *f) {
+	lock_acquire (&filesys_lock);
+	f->R.rax = fd_table_dup2 (&thread_current ()->fds, f->R.rdi, f->R.rsi);
+	lock_release (&filesys_lock);
+}
+
+/* Creates a pipe and stores the descriptors of its read and write ends
+ * in the two ints at user address RDI. */
+static void
+sys_pipe (struct intr_frame *f) {
+	int *ufds = (int *) f->R.rdi;
+	struct file *read_end, *write_end;
+	int fds[2];
+
+	check_user_buffer (ufds, sizeof fds);
+	f->R.rax = -1;
+	if (!pipe_create (&read_end, &write_end))
+		return;
+	if ((fds[0] = fd_install (read_end)) < 0) {
+		file_close (read_end);
+		file_close (write_end);
+		return;
+	}
+	if ((fds[1] = fd_install (write_end)) < 0) {
+		fd_table_remove (&thread_current ()->fds, fds[0]);
+		file_close (read_end);
+		file_close (write_end);
+		return;
+	}
+	if (copy_to_user (ufds, fds, sizeof fds) != 0)
+		terminate (-1);
+	f->R.rax = 0;
+}
+
+/* Returns the poll() events that hold for FD in the current process.
+ * Puts PT, if not null, on the wait queue of the object that FD refers
+ * to, if it has one.  Files are always ready. */
+static int
+fd_poll (int fd, struct poll_table *pt) {
+	struct file *file;
+	struct pipe *pipe;
+
+	if (fd < 0)
+		return 0;
+	if ((file = fd_lookup (fd)) == NULL)
+		return POLLNVAL;
+	if (file_is_console (file, false))
+		return input_poll (pt) ? POLLIN : 0;
+	if (file_is_console (file, true))
+		return POLLOUT;
+	if ((pipe = file_get_pipe (file, false)) != NULL)
+		return pipe_poll (pipe, false, pt);
+	if ((pipe = file_get_pipe (file, true)) != NULL)
+		return pipe_poll (pipe, true, pt);
+	return POLLIN | POLLOUT;
+}
+
+/* Waits until one of the RSI descriptors in the pollfds at RDI is ready
+ * for the events it asks for, for at most RDX milliseconds, or without a
+ * limit if RDX is negative.  Returns the number of descriptors with
+ * events, 0 on timeout. */
+static void
+sys_poll (struct intr_frame *f) {
+	struct pollfd *ufds = (struct pollfd *) f->R.rdi;
+	unsigned nfds = f->R.rsi;
+	int timeout = f->R.rdx;
+	struct pollfd *fds = NULL;
+	struct poll_entry *entries = NULL;
+	struct poll_table pt, *wait;
+	int64_t wake_time = INT64_MAX;
+	int ready;
+
+	f->R.rax = -1;
+	if (nfds > FD_MAX)
+		return;
+	check_user_buffer (ufds, nfds * sizeof *fds);
+	if (nfds > 0) {
+		fds = malloc (nfds * sizeof *fds);
+		entries = malloc (nfds * sizeof *entries);
+		if (fds == NULL || entries == NULL)
+			goto done;
+		if (copy_from_user (fds, ufds, nfds * sizeof *fds) != 0)
+			goto fault;
+	}
+	if (timeout > 0)
+		wake_time = timer_ticks ()
+			+ DIV_ROUND_UP ((int64_t) timeout * TIMER_FREQ, 1000);
+
+	/* The first pass puts the table on the wait queues, the ones after
+	 * a wakeup only recheck. */
+	poll_table_init (&pt, entries, nfds);
+	wait = timeout != 0 ? &pt : NULL;
+	for (;;) {
+		ready = 0;
+		for (unsigned i = 0; i < nfds; i++) {
+			fds[i].revents = fd_poll (fds[i].fd, wait)
+				& (fds[i].events | POLLERR | POLLHUP | POLLNVAL);
+			if (fds[i].revents != 0)
+				ready++;
+		}
+		wait = NULL;
+		if (ready > 0 || timeout == 0 || timer_ticks () >= wake_time
+				|| !poll_table_wait (&pt, wake_time))
+			break;
+	}
+	poll_table_destroy (&pt);
+
+	if (copy_to_user (ufds, fds, nfds * sizeof *fds) != 0)
+		goto fault;
+	f->R.rax = ready;
+done:
+	free (fds);
+	free (entries);
+	return;
+fault:
+	free (fds);
+	free (entries);
+	terminate (-1);
+}
+
+#ifdef VM
+static void
+sys_mmap (struct intr_frame *f) {
+	struct file *file = fd_lookup_file (f->R.r10);
+
+	f->R.rax = (uint64_t) NULL;
+	if (file != NULL) {
+		lock_acquire (&filesys_lock);
+		f->R.rax = (uint64_t) do_mmap ((void *) f->R.rdi, f->R.rsi, f->R.rdx,
+				file, f->R.r8);
+		lock_release (&filesys_lock);
+	}
+}
+
+static void
+sys_munmap (struct intr_frame *f) {
+	do_munmap ((void *) f->R.rdi);
+}
+
+/* Maps shared memory, of the file open as R10, or anonymous if R10 is
+ * -1. */
+static void
+sys_mmap_shared (struct intr_frame *f) {
+	int fd = f->R.r10;
+	struct file *file = NULL;
+
+	f->R.rax = (uint64_t) NULL;
+	if (fd != -1 && (file = fd_lookup_file (fd)) == NULL)
+		return;
+	lock_acquire (&filesys_lock);
+	f->R.rax = (uint64_t) do_mmap_shared ((void *) f->R.rdi, f->R.rsi,
+			f->R.rdx, file, f->R.r8);
+	lock_release (&filesys_lock);
+}
+
+/* Copies the VM statistics to the user buffer at RDI.  Returns false if it
+ * is not writable user memory. */
+static void
+sys_vmstat (struct intr_frame *f) {
+	struct vmstat buf;
+
+	vmstat_get (&buf);
+	f->R.rax = copy_to_user ((void *) f->R.rdi, &buf, sizeof buf) == 0;
+}
+
+static void
+sys_madvise (struct intr_frame *f) {
+	f->R.rax = vm_madvise ((void *) f->R.rdi, f->R.rsi, f->R.rdx);
+}
+
+static void
+sys_mlock (struct intr_frame *f) {
+	f->R.rax = vm_mlock ((void *) f->R.rdi, f->R.rsi);
+}
+
+static void
+sys_munlock (struct intr_frame *f) {
+	f->R.rax = vm_munlock ((void *) f->R.rdi, f->R.rsi);
 }
+#endif
@@ -0,0 +1,172 @@
+/* uaccess.c: Access to user memory from system calls.
+ *
+ * User pointers are checked only against KERN_BASE, and the memory they
+ * point to is then accessed directly.  If it turns out not to be mapped,
+ * the page fault is resolved through the exception table (see
+ * userprog/exception.c): execution resumes at a fixup that makes the
+ * routine report failure, so the kernel never walks the page table ahead
+ * of an access. */
+
+#include "userprog/uaccess.h"
+#include <string.h>
+#include "threads/vaddr.h"
+#include "userprog/exception.h"
+
+/* Returns true if the SIZE bytes at UADDR lie in user space. */
+static bool
+user_range_ok (const void *uaddr, size_t size) {
+	uint64_t start = (uint64_t) uaddr;
+
+	return start + size >= start && start + size <= KERN_BASE;
+}
+
+/* Copies SIZE bytes from SRC to DST, either of which may be user memory,
+ * eight bytes at a time.  Returns the number of bytes left uncopied
+ * because of a fault. */
+static size_t
+raw_copy (void *dst, const void *src, size_t size) {
+	size_t left = size / 8;
+
+	/* A faulting string instruction leaves RCX, RSI and RDI at the
+	 * element that faulted, so the fixups only have to turn RCX into a
+	 * byte count. */
+	asm volatile ("1: rep movsq\n\t"
+			"movq %3, %0\n"
+			"2: rep movsb\n\t"
+			"jmp 4f\n"
+			"3: leaq (%3, %0, 8), %0\n"
+			"4:\n\t"
+			EXCEPTION_TABLE_ENTRY ("1b", "3b")
+			EXCEPTION_TABLE_ENTRY ("2b", "4b")
+			: "+c" (left), "+D" (dst), "+S" (src)
+			: "r" (size % 8)
+			: "memory");
+	return left;
+}
+
+/* Reads a byte at user address UADDR, which must be below KERN_BASE.
+ * Returns the byte, or -1 if UADDR is not mapped. */
+static int64_t
+get_user (const uint8_t *uaddr) {
+	int64_t result;
+
+	asm volatile ("1: movzbq %1, %0\n\t"
+			"jmp 3f\n"
+			"2: movq $-1, %0\n"
+			"3:\n\t"
+			EXCEPTION_TABLE_ENTRY ("1b", "2b")
+			: "=r" (result) : "m" (*uaddr));
+	return result;
+}
+
+/* Reads the word at user address UADDR, which must be below KERN_BASE,
+ * into *WORD.  Returns false if UADDR is not mapped. */
+static bool
+get_user_word (uint64_t *word, const uint64_t *uaddr) {
+	int64_t error = 0;
+
+	asm volatile ("1: movq %2, %0\n\t"
+			"jmp 3f\n"
+			"2: movq $-1, %1\n"
+			"3:\n\t"
+			EXCEPTION_TABLE_ENTRY ("1b", "2b")
+			: "=r" (*word), "+r" (error) : "m" (*uaddr));
+	return error == 0;
+}
+
+/* Writes BYTE to user address UDST, which must be below KERN_BASE.
+ * Returns false if UDST is not mapped writable. */
+static bool
+put_user (uint8_t *udst, uint8_t byte) {
+	int64_t error = 0;
+
+	asm volatile ("1: movb %b2, %0\n\t"
+			"jmp 3f\n"
+			"2: movq $-1, %1\n"
+			"3:\n\t"
+			EXCEPTION_TABLE_ENTRY ("1b", "2b")
+			: "=m" (*udst), "+r" (error) : "q" (byte));
+	return error == 0;
+}
+
+/* Copies SIZE bytes from user address USRC to DST.  Returns the number
+ * of bytes that could not be copied, 0 on success. */
+size_t
+copy_from_user (void *dst, const void *usrc, size_t size) {
+	if (!user_range_ok (usrc, size))
+		return size;
+	return raw_copy (dst, usrc, size);
+}
+
+/* Copies SIZE bytes from SRC to user address UDST.  Returns the number
+ * of bytes that could not be copied, 0 on success. */
+size_t
+copy_to_user (void *udst, const void *src, size_t size) {
+	if (!user_range_ok (udst, size))
+		return size;
+	return raw_copy (udst, src, size);
+}
+
+/* Copies the string at user address USRC, including its null terminator,
+ * to DST, which has room for SIZE bytes.  Returns the length of the
+ * string, SIZE if it does not fit, or -1 if it runs into memory that is
+ * not mapped user memory.
+ *
+ * The string is read a word at a time.  Words are aligned, so a read
+ * never crosses into a page that the string does not reach. */
+int64_t
+strncpy_from_user (char *dst, const char *usrc, size_t size) {
+	uint64_t start = (uint64_t) usrc;
+	size_t i = 0;
+
+	if (start >= KERN_BASE)
+		return -1;
+
+	while (i < size) {
+		uint64_t addr = start + i;
+		uint64_t word;
+		int64_t c;
+
+		if (addr % 8 == 0 && size - i >= 8) {
+			if (!get_user_word (&word, (const uint64_t *) addr))
+				return -1;
+			if (((word - 0x0101010101010101) & ~word
+						& 0x8080808080808080) == 0) {
+				memcpy (dst + i, &word, 8);
+				i += 8;
+				continue;
+			}
+			/* The word holds the terminator. */
+			for (;; i++, word >>= 8)
+				if ((dst[i] = word & 0xff) == '\0')
+					return i;
+		}
+
+		if (addr >= KERN_BASE || (c = get_user ((const uint8_t *) addr)) < 0)
+			return -1;
+		if ((dst[i] = c) == '\0')
+			return i;
+		i++;
+	}
+	return size;
+}
+
+/* Returns true if the SIZE bytes at UADDR are mapped user memory,
+ * writable if WRITE is true.  One byte per page is touched, which also
+ * brings in pages that are not resident yet, so the memory can then be
+ * accessed directly, even with locks held. */
+bool
+probe_user (const void *uaddr, size_t size, bool write) {
+	const uint8_t *p = uaddr;
+	const uint8_t *end = p + size;
+
+	if (!user_range_ok (uaddr, size))
+		return false;
+	for (; p < end; p = (const uint8_t *) pg_round_down (p) + PGSIZE) {
+		int64_t byte = get_user (p);
+
+		if (byte < 0 || (write && !put_user ((uint8_t *) p, byte)))
+			return false;
+	}
+	return true;
+}
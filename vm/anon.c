@@ -1,7 +1,12 @@
 /* anon.c: Implementation of page for non-disk image (a.k.a. anonymous page). */
 
+#include <bitmap.h>
+#include <string.h>
 #include "vm/vm.h"
+#include "vm/zswap.h"
 #include "devices/disk.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
 
 /* DO NOT MODIFY BELOW LINE */
 static struct disk *swap_disk;
@@ -17,36 +22,141 @@ static const struct page_operations anon_ops = {
 	.type = VM_ANON,
 };
 
+/* Number of disk sectors in a swap slot. */
+#define SECTORS_PER_SLOT (PGSIZE / DISK_SECTOR_SIZE)
+
+/* Swap slots in use, one bit per page-sized slot of swap_disk. */
+static struct bitmap *swap_table;
+static struct lock swap_lock;
+
 /* Initialize the data for anonymous pages */
 void
 vm_anon_init (void) {
-	/* TODO: Set up the swap_disk. */
-	swap_disk = NULL;
+	size_t slot_cnt;
+
+	swap_disk = disk_get (1, 1);
+	slot_cnt = swap_disk != NULL ? disk_size (swap_disk) / SECTORS_PER_SLOT : 0;
+	swap_table = bitmap_create (slot_cnt);
+	if (swap_table == NULL)
+		PANIC ("anon: cannot allocate swap table");
+	lock_init (&swap_lock);
+	zswap_init ();
 }
 
 /* Initialize the file mapping */
 bool
-anon_initializer (struct page *page, enum vm_type type, void *kva) {
+anon_initializer (struct page *page, enum vm_type type UNUSED, void *kva) {
 	/* Set up the handler */
 	page->operations = &anon_ops;
 
 	struct anon_page *anon_page = &page->anon;
+	anon_page->store = ANON_RESIDENT;
+	memset (kva, 0, PGSIZE);
+	return true;
+}
+
+/* Returns true if the page at KVA is all zero. */
+static bool
+page_is_zero (const void *kva) {
+	const uint64_t *p = kva;
+
+	for (size_t i = 0; i < PGSIZE / sizeof *p; i++)
+		if (p[i] != 0)
+			return false;
+	return true;
+}
+
+/* Releases the swap slot SLOT. */
+static void
+swap_slot_free (size_t slot) {
+	lock_acquire (&swap_lock);
+	bitmap_reset (swap_table, slot);
+	lock_release (&swap_lock);
 }
 
 /* Swap in the page by read contents from the swap disk. */
 static bool
 anon_swap_in (struct page *page, void *kva) {
 	struct anon_page *anon_page = &page->anon;
+
+	switch (anon_page->store) {
+		case ANON_ZERO:
+			memset (kva, 0, PGSIZE);
+			break;
+		case ANON_ZSWAP:
+			zswap_load (&anon_page->zswap, kva);
+			zswap_free (&anon_page->zswap);
+			break;
+		case ANON_KSM:
+			memcpy (kva, anon_page->ksm->kva, PGSIZE);
+			vm_ksm_put (anon_page->ksm);
+			break;
+		case ANON_SWAP:
+			for (int i = 0; i < SECTORS_PER_SLOT; i++)
+				disk_read (swap_disk, anon_page->swap_slot * SECTORS_PER_SLOT + i,
+						(uint8_t *) kva + i * DISK_SECTOR_SIZE);
+			swap_slot_free (anon_page->swap_slot);
+			break;
+		default:
+			return false;
+	}
+	anon_page->store = ANON_RESIDENT;
+	vmstat_count (VMSTAT_SWAP_IN);
+	return true;
 }
 
-/* Swap out the page by writing contents to the swap disk. */
+/* Swap out the page by writing contents to the swap disk.  Zero pages are
+ * only flagged, and pages that compress well go to the zswap arena while
+ * it has room. */
 static bool
 anon_swap_out (struct page *page) {
 	struct anon_page *anon_page = &page->anon;
+	void *kva = page->frame->kva;
+	size_t slot;
+
+	vmstat_count (VMSTAT_SWAP_OUT);
+	if (page_is_zero (kva)) {
+		anon_page->store = ANON_ZERO;
+		return true;
+	}
+	if (zswap_store (kva, &anon_page->zswap)) {
+		anon_page->store = ANON_ZSWAP;
+		return true;
+	}
+
+	lock_acquire (&swap_lock);
+	slot = bitmap_scan_and_flip (swap_table, 0, 1, false);
+	lock_release (&swap_lock);
+	if (slot == BITMAP_ERROR)
+		return false;
+
+	for (int i = 0; i < SECTORS_PER_SLOT; i++)
+		disk_write (swap_disk, slot * SECTORS_PER_SLOT + i,
+				(uint8_t *) kva + i * DISK_SECTOR_SIZE);
+	anon_page->swap_slot = slot;
+	anon_page->store = ANON_SWAP;
+	return true;
+}
+
+/* Drops the contents of PAGE, wherever they are, and makes it a zero
+ * fill page. */
+void
+anon_discard (struct page *page) {
+	struct anon_page *anon_page = &page->anon;
+
+	/* Unmap before letting go of a merged page. */
+	vm_free_frame (page);
+	if (anon_page->store == ANON_ZSWAP)
+		zswap_free (&anon_page->zswap);
+	else if (anon_page->store == ANON_SWAP)
+		swap_slot_free (anon_page->swap_slot);
+	else if (anon_page->store == ANON_KSM)
+		vm_ksm_put (anon_page->ksm);
+	anon_page->store = ANON_ZERO;
 }
 
 /* Destroy the anonymous page. PAGE will be freed by the caller. */
 static void
 anon_destroy (struct page *page) {
-	struct anon_page *anon_page = &page->anon;
+	anon_discard (page);
 }
@@ -1,6 +1,12 @@
 /* file.c: Implementation of memory backed file object (mmaped object). */
 
+#include <round.h>
 #include "vm/vm.h"
+#include "filesys/inode.h"
+#include "filesys/page_cache.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
 
 static bool file_backed_swap_in (struct page *page, void *kva);
 static bool file_backed_swap_out (struct page *page);
@@ -14,45 +20,488 @@ static const struct page_operations file_ops = {
 	.type = VM_FILE,
 };
 
+/* File backed pages have no frames of their own: they map the pages of
+ * the page cache that hold their part of the file, which are shared with
+ * every other mapping of the same part and with read() and write().  The
+ * page cache also takes care of writing modified data back.
+ *
+ * Readahead.
+ *
+ * A fault on an mmaped page updates the access pattern of its region.  If
+ * the faults look sequential, the pages after the faulting one are queued
+ * for the readahead daemon, which loads them in the background while the
+ * process works on the pages it already has.  The window starts at RA_MIN
+ * pages and doubles on every sequential fault up to RA_MAX.  A constant
+ * stride queues the next pages of the stride instead, and anything else
+ * shuts readahead off for the region until it looks sequential again.
+ *
+ * The daemon only ever uses free frames, so readahead never evicts a page
+ * that is in use.  A queued page is taken off the queue as soon as its
+ * owner touches it in any other way; see file_readahead_cancel(). */
+#define RA_MIN 4                /* Initial readahead window, in pages. */
+#define RA_MAX 64               /* Maximum readahead window, in pages. */
+#define RA_STRIDE_PAGES 8       /* Pages queued ahead of a strided scan. */
+
+static struct list ra_queue;    /* Pages waiting to be read ahead. */
+static struct lock ra_lock;     /* Protects ra_queue and page->readahead. */
+static struct condition ra_work;  /* Signaled when ra_queue grows. */
+static struct condition ra_done;  /* Signaled when a page is loaded. */
+
+static thread_func readahead_daemon NO_RETURN;
+
 /* The initializer of file vm */
 void
 vm_file_init (void) {
+	list_init (&ra_queue);
+	lock_init (&ra_lock);
+	cond_init (&ra_work);
+	cond_init (&ra_done);
+	if (thread_create ("readahead", PRI_DEFAULT, readahead_daemon, NULL)
+			== TID_ERROR)
+		PANIC ("vm: cannot start readahead daemon");
 }
 
-/* Initialize the file backed page */
+/* Initialize the file backed page.  The page takes over the file_page
+ * that was its AUX while it was uninit, including the file handle; the
+ * init callback frees what is left of AUX. */
 bool
-file_backed_initializer (struct page *page, enum vm_type type, void *kva) {
+file_backed_initializer (struct page *page, enum vm_type type UNUSED,
+		void *kva UNUSED) {
+	struct file_page *aux = page->uninit.aux;
+
 	/* Set up the handler */
 	page->operations = &file_ops;
 
-	struct file_page *file_page = &page->file;
+	page->file = *aux;
+	return true;
+}
+
+/* Init callback of file backed pages.  There is nothing to load, since
+ * the page maps the page cache; just frees AUX, whose contents
+ * file_backed_initializer() already copied into the page. */
+bool
+file_backed_lazy_load (struct page *page UNUSED, void *aux) {
+	free (aux);
+	return true;
+}
+
+/* Maps PAGE to its page in the page cache, initializing it first if it is
+ * still uninit.  A SPECULATIVE claim fails rather than evict anything. */
+bool
+file_backed_claim (struct page *page, bool speculative) {
+	if (VM_TYPE (page->operations->type) == VM_UNINIT
+			&& !swap_in (page, NULL))
+		return false;
+	return page_cache_map (page, speculative);
+}
+
+/* Returns true if the contents of PAGE, a file backed page that may still
+ * be uninit, are in the page cache. */
+bool
+file_backed_cached (struct page *page) {
+	struct file_page *file_page = VM_TYPE (page->operations->type) == VM_UNINIT
+		? page->uninit.aux : &page->file;
+
+	return file_page->cache != NULL
+		|| page_cache_contains (file_get_inode (file_page->file),
+				file_page->offset);
 }
 
-/* Swap in the page by read contents from the file. */
+/* File backed pages are brought in by file_backed_claim(), never through
+ * a frame. */
 static bool
-file_backed_swap_in (struct page *page, void *kva) {
-	struct file_page *file_page UNUSED = &page->file;
+file_backed_swap_in (struct page *page UNUSED, void *kva UNUSED) {
+	return false;
 }
 
-/* Swap out the page by writeback contents to the file. */
+/* Unmaps PAGE from the page cache, which writes it back if needed. */
 static bool
 file_backed_swap_out (struct page *page) {
-	struct file_page *file_page UNUSED = &page->file;
+	page_cache_unmap (page);
+	return true;
+}
+
+/* Unmaps PAGE from the page cache.  The next access maps it again; a
+ * modification reaches the file through the cache. */
+void
+file_backed_discard (struct page *page) {
+	page_cache_unmap (page);
 }
 
 /* Destory the file backed page. PAGE will be freed by the caller. */
 static void
 file_backed_destroy (struct page *page) {
-	struct file_page *file_page UNUSED = &page->file;
+	file_backed_discard (page);
+	file_close (page->file.file);
+}
+
+/* Returns the region of SPT that starts at ADDR, or NULL. */
+static struct mmap_region *
+find_region (struct supplemental_page_table *spt, void *addr) {
+	struct list_elem *e;
+
+	for (e = list_begin (&spt->mmaps); e != list_end (&spt->mmaps);
+			e = list_next (e)) {
+		struct mmap_region *region = list_entry (e, struct mmap_region, elem);
+		if (region->addr == addr)
+			return region;
+	}
+	return NULL;
+}
+
+/* Removes the first PAGE_CNT pages at ADDR from SPT. */
+static void
+remove_pages (struct supplemental_page_table *spt, void *addr,
+		size_t page_cnt) {
+	for (size_t i = 0; i < page_cnt; i++) {
+		struct page *page = spt_find_page (spt, (uint8_t *) addr + i * PGSIZE);
+		if (page != NULL)
+			spt_remove_page (spt, page);
+	}
+}
+
+/* Checks that LENGTH bytes at ADDR are a valid place for a new mapping in
+ * SPT: page aligned, inside user memory and not mapped yet.  Returns the
+ * number of pages of the mapping, or 0 if the range is not valid. */
+static size_t
+mmap_check (struct supplemental_page_table *spt, void *addr, size_t length) {
+	size_t page_cnt;
+
+	if (addr == NULL || pg_ofs (addr) != 0 || length == 0
+			|| !is_user_vaddr (addr))
+		return 0;
+	page_cnt = DIV_ROUND_UP (length, PGSIZE);
+	if (page_cnt > ((uint64_t) USER_STACK - (uint64_t) addr) / PGSIZE)
+		return 0;
+	for (size_t i = 0; i < page_cnt; i++)
+		if (spt_find_page (spt, (uint8_t *) addr + i * PGSIZE) != NULL)
+			return 0;
+	return page_cnt;
+}
+
+/* Returns a new region of PAGE_CNT pages at ADDR, or NULL if memory is
+ * exhausted. */
+static struct mmap_region *
+region_create (void *addr, size_t page_cnt) {
+	struct mmap_region *region = malloc (sizeof *region);
+
+	if (region != NULL) {
+		region->addr = addr;
+		region->page_cnt = page_cnt;
+		region->last_fault = 0;
+		region->stride = 0;
+		region->ra_pages = 0;
+		region->faulted = false;
+	}
+	return region;
 }
 
 /* Do the mmap */
 void *
 do_mmap (void *addr, size_t length, int writable,
 		struct file *file, off_t offset) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	struct mmap_region *region;
+	size_t page_cnt;
+	off_t file_len;
+
+	if (offset < 0 || offset % PGSIZE != 0 || file == NULL)
+		return NULL;
+	file_len = file_length (file);
+	if (file_len == 0)
+		return NULL;
+	page_cnt = mmap_check (spt, addr, length);
+	if (page_cnt == 0)
+		return NULL;
+	region = region_create (addr, page_cnt);
+	if (region == NULL)
+		return NULL;
+
+	/* Stores to the pages reach the file without a write. */
+	if (writable)
+		inode_map_writable (file_get_inode (file));
+
+	for (size_t i = 0; i < page_cnt; i++) {
+		off_t ofs = offset + i * PGSIZE;
+		size_t left = i * PGSIZE < length ? length - i * PGSIZE : 0;
+		size_t file_left = ofs < file_len ? (size_t) (file_len - ofs) : 0;
+		struct file_page *aux = malloc (sizeof *aux);
+
+		if (aux != NULL) {
+			aux->file = file_reopen (file);
+			if (aux->file == NULL) {
+				free (aux);
+				aux = NULL;
+			}
+		}
+		if (aux == NULL)
+			goto fail;
+		aux->offset = ofs;
+		aux->read_bytes = left < file_left ? left : file_left;
+		if (aux->read_bytes > PGSIZE)
+			aux->read_bytes = PGSIZE;
+		aux->zero_bytes = PGSIZE - aux->read_bytes;
+		aux->region = region;
+		aux->cache = NULL;
+
+		if (!vm_alloc_page_with_initializer (VM_FILE,
+					(uint8_t *) addr + i * PGSIZE, writable,
+					file_backed_lazy_load, aux)) {
+			file_page_free (aux);
+			goto fail;
+		}
+	}
+	list_push_back (&spt->mmaps, &region->elem);
+	return addr;
+
+fail:
+	remove_pages (spt, addr, page_cnt);
+	free (region);
+	return NULL;
+}
+
+/* Maps LENGTH bytes at ADDR shared with child processes rather than
+ * copied on fork.  A mapping of FILE is an ordinary do_mmap() mapping,
+ * whose pages are the file's pages in the page cache and so already
+ * shared with every other mapping and with read() and write().  If FILE
+ * is null, the mapping is a new anonymous shared object. */
+void *
+do_mmap_shared (void *addr, size_t length, int writable,
+		struct file *file, off_t offset) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	struct mmap_region *region;
+	struct vm_object *obj;
+	size_t page_cnt;
+
+	if (file != NULL)
+		return do_mmap (addr, length, writable, file, offset);
+	page_cnt = mmap_check (spt, addr, length);
+	if (page_cnt == 0)
+		return NULL;
+
+	obj = vm_object_create (page_cnt);
+	if (obj == NULL)
+		return NULL;
+	region = region_create (addr, page_cnt);
+	if (region == NULL)
+		goto done;
+	for (size_t i = 0; i < page_cnt; i++)
+		if (!vm_object_map (obj, i, (uint8_t *) addr + i * PGSIZE, writable)) {
+			remove_pages (spt, addr, i);
+			free (region);
+			region = NULL;
+			goto done;
+		}
+	list_push_back (&spt->mmaps, &region->elem);
+
+done:
+	vm_object_put (obj);
+	return region != NULL ? addr : NULL;
 }
 
 /* Do the munmap */
 void
 do_munmap (void *addr) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	struct mmap_region *region = find_region (spt, addr);
+
+	if (region == NULL)
+		return;
+	remove_pages (spt, region->addr, region->page_cnt);
+	list_remove (&region->elem);
+	free (region);
+}
+
+/* Copies the mmap regions of SRC into DST, for fork.  The pages are
+ * copied separately and attached with file_mmap_rebind(). */
+bool
+file_mmap_copy (struct supplemental_page_table *dst,
+		struct supplemental_page_table *src) {
+	struct list_elem *e;
+
+	for (e = list_begin (&src->mmaps); e != list_end (&src->mmaps);
+			e = list_next (e)) {
+		struct mmap_region *region = list_entry (e, struct mmap_region, elem);
+		struct mmap_region *copy = malloc (sizeof *copy);
+
+		if (copy == NULL)
+			return false;
+		copy->addr = region->addr;
+		copy->page_cnt = region->page_cnt;
+		copy->last_fault = 0;
+		copy->stride = 0;
+		copy->ra_pages = 0;
+		copy->faulted = false;
+		list_push_back (&dst->mmaps, &copy->elem);
+	}
+	return true;
+}
+
+/* Points INFO, copied from a page of another process, at the matching
+ * region of SPT. */
+void
+file_mmap_rebind (struct file_page *info, struct supplemental_page_table *spt) {
+	if (info->region != NULL)
+		info->region = find_region (spt, info->region->addr);
+}
+
+/* Frees the mmap regions of SPT, whose pages must already be gone. */
+void
+file_mmap_kill (struct supplemental_page_table *spt) {
+	while (!list_empty (&spt->mmaps))
+		free (list_entry (list_pop_front (&spt->mmaps),
+					struct mmap_region, elem));
+}
+
+/* Queues PAGE for the readahead daemon if it is not resident and not
+ * queued yet.  Must be called with ra_lock held. */
+static void
+readahead_queue (struct page *page) {
+	ASSERT (lock_held_by_current_thread (&ra_lock));
+
+	if (vm_page_resident (page) || page->readahead != RA_NONE)
+		return;
+	page->readahead = RA_QUEUED;
+	list_push_back (&ra_queue, &page->ra_elem);
+}
+
+/* Queues the page at index IDX of REGION in SPT, if there is one. */
+static void
+readahead_queue_index (struct supplemental_page_table *spt,
+		struct mmap_region *region, size_t idx) {
+	struct page *page = spt_find_page (spt,
+			(uint8_t *) region->addr + idx * PGSIZE);
+
+	if (page != NULL)
+		readahead_queue (page);
+}
+
+/* Records a fault on the just loaded file backed PAGE and starts
+ * readahead for the pages its region is expected to touch next. */
+void
+file_readahead (struct page *page) {
+	struct mmap_region *region = page->file.region;
+	struct supplemental_page_table *spt = &page->owner->spt;
+	size_t idx;
+	long delta;
+
+	if (region == NULL || page->advice == MADV_RANDOM)
+		return;
+	idx = ((uint8_t *) page->va - (uint8_t *) region->addr) / PGSIZE;
+	delta = region->faulted ? (long) idx - (long) region->last_fault : 1;
+
+	lock_acquire (&ra_lock);
+	if (page->advice == MADV_SEQUENTIAL) {
+		/* Advised sequential: no need to wait for the pattern. */
+		region->ra_pages = RA_MAX;
+		for (size_t i = idx + 1; i < region->page_cnt && i <= idx + RA_MAX; i++)
+			readahead_queue_index (spt, region, i);
+	} else if (delta > 0
+			&& delta <= (long) (region->ra_pages + FAULT_AROUND_PAGES)) {
+		/* Sequential: grow the window and queue the pages after IDX.  Pages
+		 * that fault-around already mapped count against the window, so
+		 * that readahead stays ahead of the scan instead of redoing it. */
+		size_t end;
+
+		region->ra_pages = region->ra_pages == 0 ? RA_MIN
+			: region->ra_pages * 2 > RA_MAX ? RA_MAX : region->ra_pages * 2;
+		end = idx + 1 + region->ra_pages;
+		if (end > region->page_cnt)
+			end = region->page_cnt;
+		for (size_t i = idx + 1; i < end; i++)
+			readahead_queue_index (spt, region, i);
+	} else if (delta != 0 && delta == region->stride) {
+		/* Strided: queue the next pages of the stride. */
+		for (long k = 1; k <= RA_STRIDE_PAGES; k++) {
+			long next = (long) idx + k * delta;
+			if (next < 0 || next >= (long) region->page_cnt)
+				break;
+			readahead_queue_index (spt, region, next);
+		}
+	} else
+		region->ra_pages = 0;
+	if (!list_empty (&ra_queue))
+		cond_signal (&ra_work, &ra_lock);
+	lock_release (&ra_lock);
+
+	region->stride = delta;
+	region->last_fault = idx;
+	region->faulted = true;
+}
+
+/* Takes PAGE off the readahead queue, or waits until the daemon has
+ * finished loading it.  Afterwards the daemon no longer touches PAGE, so
+ * the caller may fault it in, copy it or destroy it. */
+void
+file_readahead_cancel (struct page *page) {
+	lock_acquire (&ra_lock);
+	if (page->readahead == RA_QUEUED) {
+		list_remove (&page->ra_elem);
+		page->readahead = RA_NONE;
+	}
+	while (page->readahead == RA_LOADING)
+		cond_wait (&ra_done, &ra_lock);
+	lock_release (&ra_lock);
+}
+
+/* Queues PAGE, which may be of any type, for the readahead daemon.  Used
+ * for MADV_WILLNEED. */
+void
+file_readahead_page (struct page *page) {
+	lock_acquire (&ra_lock);
+	readahead_queue (page);
+	if (!list_empty (&ra_queue))
+		cond_signal (&ra_work, &ra_lock);
+	lock_release (&ra_lock);
+}
+
+/* Loads the pages on the readahead queue, one at a time. */
+static void
+readahead_daemon (void *aux UNUSED) {
+	lock_acquire (&ra_lock);
+	for (;;) {
+		struct page *page;
+
+		while (list_empty (&ra_queue))
+			cond_wait (&ra_work, &ra_lock);
+		page = list_entry (list_pop_front (&ra_queue), struct page, ra_elem);
+		page->readahead = RA_LOADING;
+		lock_release (&ra_lock);
+
+		/* If memory is tight, readahead is the first thing to go. */
+		if (!vm_page_resident (page) && !vm_prefetch_page (page)) {
+			lock_acquire (&ra_lock);
+			while (!list_empty (&ra_queue))
+				list_entry (list_pop_front (&ra_queue), struct page,
+						ra_elem)->readahead = RA_NONE;
+		} else
+			lock_acquire (&ra_lock);
+		page->readahead = RA_NONE;
+		cond_broadcast (&ra_done, &ra_lock);
+	}
+}
+
+/* Returns a copy of INFO with its own handle on the file, or NULL if
+ * memory is exhausted. */
+struct file_page *
+file_page_duplicate (const struct file_page *info) {
+	struct file_page *copy = malloc (sizeof *copy);
+
+	if (copy == NULL)
+		return NULL;
+	*copy = *info;
+	copy->cache = NULL;
+	copy->file = file_reopen (info->file);
+	if (copy->file == NULL) {
+		free (copy);
+		return NULL;
+	}
+	return copy;
+}
+
+/* Closes the file handle of INFO and frees it. */
+void
+file_page_free (struct file_page *info) {
+	file_close (info->file);
+	free (info);
 }
@@ -0,0 +1,156 @@
+/* object.c: Shared memory objects, the VM object layer below shared
+ * mappings. */
+
+#include "vm/vm.h"
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+static bool shared_swap_in (struct page *page, void *kva);
+static bool shared_swap_out (struct page *page);
+static void shared_destroy (struct page *page);
+
+static const struct page_operations shared_ops = {
+	.swap_in = shared_swap_in,
+	.swap_out = shared_swap_out,
+	.destroy = shared_destroy,
+	.type = VM_SHARED,
+};
+
+/* Creates an object of PAGE_CNT zero-filled pages.  The caller holds the
+ * only reference, which it drops with vm_object_put() once the object is
+ * mapped.  Returns NULL if memory is exhausted. */
+struct vm_object *
+vm_object_create (size_t page_cnt) {
+	struct vm_object *obj = malloc (sizeof *obj);
+
+	if (obj == NULL)
+		return NULL;
+	obj->kpages = calloc (page_cnt, sizeof *obj->kpages);
+	if (obj->kpages == NULL) {
+		free (obj);
+		return NULL;
+	}
+	lock_init (&obj->lock);
+	obj->ref_cnt = 1;
+	obj->page_cnt = page_cnt;
+	return obj;
+}
+
+/* Drops a reference to OBJ.  The last one frees the object. */
+void
+vm_object_put (struct vm_object *obj) {
+	bool last;
+
+	lock_acquire (&obj->lock);
+	last = --obj->ref_cnt == 0;
+	lock_release (&obj->lock);
+	if (!last)
+		return;
+
+	for (size_t i = 0; i < obj->page_cnt; i++)
+		if (obj->kpages[i] != NULL)
+			palloc_free_page (obj->kpages[i]);
+	free (obj->kpages);
+	free (obj);
+}
+
+/* Maps page IDX of OBJ at VA in the current process, taking a reference
+ * to OBJ.  The page is brought in on its first fault. */
+bool
+vm_object_map (struct vm_object *obj, size_t idx, void *va, bool writable) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	struct page *page;
+
+	ASSERT (idx < obj->page_cnt);
+
+	if (spt_find_page (spt, va) != NULL)
+		return false;
+	page = malloc (sizeof *page);
+	if (page == NULL)
+		return false;
+	*page = (struct page) {
+		.operations = &shared_ops,
+		.va = pg_round_down (va),
+		.owner = thread_current (),
+		.writable = writable,
+		.readahead = RA_NONE,
+		.shared = (struct shared_page) {
+			.obj = obj,
+			.idx = idx,
+		},
+	};
+	if (!spt_insert_page (spt, page)) {
+		free (page);
+		return false;
+	}
+
+	lock_acquire (&obj->lock);
+	obj->ref_cnt++;
+	lock_release (&obj->lock);
+	return true;
+}
+
+/* Maps the object page of PAGE in its owner's page table, bringing the
+ * object page in first if no process has touched it yet.  The mapping is
+ * charged to the owner as a locked page, since it cannot be evicted;
+ * fails if that would take the owner over its mlock() limit. */
+bool
+shared_page_claim (struct page *page) {
+	struct vm_object *obj = page->shared.obj;
+	size_t idx = page->shared.idx;
+	void *kpage;
+
+	if (pml4_get_page (page->owner->pml4, page->va) != NULL)
+		return true;
+	if (!vm_charge_locked (page->owner))
+		return false;
+
+	lock_acquire (&obj->lock);
+	kpage = obj->kpages[idx];
+	if (kpage == NULL) {
+		kpage = vm_get_kpage ();
+		if (kpage == NULL) {
+			lock_release (&obj->lock);
+			vm_uncharge_locked (page->owner);
+			return false;
+		}
+		memset (kpage, 0, PGSIZE);
+		obj->kpages[idx] = kpage;
+	}
+	lock_release (&obj->lock);
+
+	if (!vm_set_pte (page, kpage)) {
+		vm_uncharge_locked (page->owner);
+		return false;
+	}
+	return true;
+}
+
+/* Object pages are brought in by shared_page_claim(), never through a
+ * frame. */
+static bool
+shared_swap_in (struct page *page UNUSED, void *kva UNUSED) {
+	return false;
+}
+
+/* Object pages are never evicted. */
+static bool
+shared_swap_out (struct page *page UNUSED) {
+	return false;
+}
+
+/* Unmaps PAGE, uncharging its owner, and drops its reference to the
+ * object. */
+static void
+shared_destroy (struct page *page) {
+	uint64_t *pml4 = page->owner->pml4;
+
+	if (pml4 != NULL && pml4_get_page (pml4, page->va) != NULL) {
+		pml4_clear_page (pml4, page->va);
+		vm_uncharge_locked (page->owner);
+	}
+	vm_object_put (page->shared.obj);
+}
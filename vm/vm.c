@@ -1,8 +1,113 @@
 /* vm.c: Generic interface for virtual memory objects. */
 
+#include <round.h>
+#include <string.h>
+#include "threads/interrupt.h"
 #include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
 #include "vm/vm.h"
 #include "vm/inspect.h"
+#include "filesys/page_cache.h"
+#include "devices/timer.h"
+
+/* Frame table: every user frame that holds the contents of a page, in the
+ * order the clock hand sweeps them.  Frames appear here only once their
+ * contents are loaded, so a half-loaded frame is never chosen as a victim. */
+static struct list frame_table;
+static struct list_elem *clock_hand;
+
+/* Protects the frame table, and the page <-> frame links of every page
+ * that is in it. */
+static struct lock frame_lock;
+
+/* A page of zeros, mapped read-only for reads of anonymous pages that were
+ * never written.  A write to such a page allocates its frame. */
+static void *zero_page;
+
+/* Signaled on frame_lock whenever a frame is unpinned. */
+static struct condition unpin_cond;
+
+/* Maximum size of a user stack, in pages, including its guard page.  Set
+ * with the -stack kernel option. */
+size_t vm_stack_limit = 256;
+
+/* Default resident set limit of new threads, in pages, or 0 for none.
+ * Set with the -rss kernel option. */
+size_t vm_rss_limit;
+
+/* Maximum number of pages a process may lock with mlock().  Set with the
+ * -mlock kernel option. */
+size_t vm_mlock_limit = 64;
+
+/* Working set estimation.
+ *
+ * With a resident set limit given by the -rss kernel option, every
+ * WSS_INTERVAL ticks the estimator sweeps the frame table and counts,
+ * per process, the pages whose accessed bit was set since the previous
+ * sweep.  The count is folded into thread->wss as a moving average.  The
+ * accessed bit is moved into frame->referenced rather than lost, so the
+ * clock still sees it. */
+#define WSS_INTERVAL (TIMER_FREQ / 4)
+static unsigned wss_epoch;
+static thread_func wss_daemon NO_RETURN;
+
+/* Same page merging.
+ *
+ * When enabled with the -ksm kernel option, a low priority thread walks
+ * the frame table, KSM_BATCH frames every KSM_INTERVAL ticks, looking for
+ * anonymous pages with identical contents.  A page is a candidate once its
+ * checksum is the same on two consecutive passes.  Candidates go into the
+ * unstable table, and when two of them turn out to be equal, one frame
+ * becomes a ksm_node in the stable table.  Its page and every later page
+ * with the same contents then map the node read-only, and their frames
+ * are freed.  A write to a merged page gets a private copy through
+ * vm_handle_wp().
+ *
+ * Both tables and all merging are protected by frame_lock.  The final
+ * comparison and the switch of the mapping are done with interrupts off,
+ * so the owner cannot write to the page in between. */
+#define KSM_INTERVAL (TIMER_FREQ / 10)
+#define KSM_BATCH 64
+bool vm_ksm_enabled;
+static struct hash ksm_stable;          /* struct ksm_node by checksum. */
+static struct hash ksm_unstable;        /* struct frame by checksum. */
+static struct list_elem *ksm_cursor;    /* Next frame to scan. */
+static thread_func ksm_daemon NO_RETURN;
+static hash_hash_func ksm_node_hash, ksm_frame_hash;
+static hash_less_func ksm_node_less, ksm_frame_less;
+
+/* Background reclaim.
+ *
+ * The reclaim daemon keeps free frames in the user pool, so that a fault
+ * usually gets a frame at once instead of waiting for a victim to be
+ * written out.  It is woken whenever an allocation leaves fewer than
+ * reclaim_low frames free, and evicts pages until reclaim_high frames are
+ * free.  Faults still evict on their own if the daemon falls behind.
+ * Speculative loads leave the last reclaim_low free frames to faults, so
+ * that the daemon never has to evict pages in use to make room for
+ * readahead. */
+#define RECLAIM_LOW_RATIO 64    /* Low watermark, as a fraction of the
+                                   user pool. */
+static size_t reclaim_low, reclaim_high;
+static struct semaphore reclaim_sema;
+static thread_func reclaim_daemon NO_RETURN;
+
+/* Transparent huge pages.
+ *
+ * With the -thp kernel option, a fault on an anonymous page that holds
+ * only zeros tries to map the whole HPGSIZE aligned block around it with
+ * one huge page.  That takes every page of the block to be such a page of
+ * the same process, and an aligned block of THP_PAGES free frames above
+ * the reclaim reserve; otherwise the fault falls back to a single frame.
+ *
+ * Each page of a huge page keeps its own struct frame in the frame table,
+ * so eviction, merging and munmap still work page by page.  The page
+ * table code splits the huge mapping as soon as one of its pages is
+ * unmapped or remapped. */
+#define THP_PAGES (HPGSIZE / PGSIZE)
+bool vm_thp_enabled;
 
 /* Initializes the virtual memory subsystem by invoking each subsystem's
  * intialize codes. */
@@ -15,7 +120,32 @@ vm_init (void) {
 #endif
 	register_inspect_intr ();
 	/* DO NOT MODIFY UPPER LINES. */
-	/* TODO: Your code goes here. */
+#ifndef EFILESYS
+	pagecache_init ();
+#endif
+	list_init (&frame_table);
+	lock_init (&frame_lock);
+	cond_init (&unpin_cond);
+	clock_hand = NULL;
+	zero_page = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+	hash_init (&ksm_stable, ksm_node_hash, ksm_node_less, NULL);
+	hash_init (&ksm_unstable, ksm_frame_hash, ksm_frame_less, NULL);
+	ksm_cursor = NULL;
+	reclaim_low = DIV_ROUND_UP (palloc_free_cnt (PAL_USER), RECLAIM_LOW_RATIO);
+	reclaim_high = reclaim_low * 2;
+	sema_init (&reclaim_sema, 0);
+	if (thread_create ("reclaim", PRI_DEFAULT, reclaim_daemon, NULL)
+			== TID_ERROR)
+		PANIC ("vm: cannot start reclaim daemon");
+	/* The working set estimate only matters to processes with a resident
+	 * set limit, and sweeping the frame table is not free. */
+	if (vm_rss_limit != 0
+			&& thread_create ("wss", PRI_DEFAULT, wss_daemon, NULL)
+			== TID_ERROR)
+		PANIC ("vm: cannot start working set estimator");
+	if (vm_ksm_enabled
+			&& thread_create ("ksm", PRI_MIN, ksm_daemon, NULL) == TID_ERROR)
+		PANIC ("vm: cannot start same page merging");
 }
 
 /* Get the type of the page. This function is useful if you want to know the
@@ -33,9 +163,15 @@ page_get_type (struct page *page) {
 }
 
 /* Helpers */
-static struct frame *vm_get_victim (void);
+static struct frame *vm_get_victim (struct thread *owner);
 static bool vm_do_claim_page (struct page *page);
-static struct frame *vm_evict_frame (void);
+static struct frame *vm_evict_frame (struct thread *owner);
+static struct frame *vm_try_get_frame (void);
+static bool vm_map_frame (struct page *page, struct frame *frame);
+static void vm_fault_around (struct page *page, struct inode *inode);
+static uint64_t page_hash (const struct hash_elem *e, void *aux);
+static bool page_less (const struct hash_elem *a, const struct hash_elem *b,
+		void *aux);
 
 /* Create the pending page object with initializer. If you want to create a
  * page, do not create it directly and make it through this function or
@@ -50,11 +186,36 @@ vm_alloc_page_with_initializer (enum vm_type type, void *upage, bool writable,
 
 	/* Check wheter the upage is already occupied or not. */
 	if (spt_find_page (spt, upage) == NULL) {
-		/* TODO: Create the page, fetch the initialier according to the VM type,
-		 * TODO: and then create "uninit" page struct by calling uninit_new. You
-		 * TODO: should modify the field after calling the uninit_new. */
+		bool (*initializer) (struct page *, enum vm_type, void *);
+		struct page *page;
+
+		switch (VM_TYPE (type)) {
+			case VM_ANON:
+				initializer = anon_initializer;
+				break;
+			case VM_FILE:
+				initializer = file_backed_initializer;
+				break;
+			default:
+				goto err;
+		}
 
-		/* TODO: Insert the page into the spt. */
+		page = malloc (sizeof *page);
+		if (page == NULL)
+			goto err;
+		uninit_new (page, pg_round_down (upage), init, type, aux, initializer);
+		page->owner = thread_current ();
+		page->writable = writable;
+		page->ro_mapped = false;
+		page->readahead = RA_NONE;
+		page->advice = MADV_NORMAL;
+		page->locked = false;
+
+		if (!spt_insert_page (spt, page)) {
+			free (page);
+			goto err;
+		}
+		return true;
 	}
 err:
 	return false;
@@ -62,82 +223,1181 @@ err:
 
 /* Find VA from spt and return page. On error, return NULL. */
 struct page *
-spt_find_page (struct supplemental_page_table *spt UNUSED, void *va UNUSED) {
-	struct page *page = NULL;
-	/* TODO: Fill this function. */
+spt_find_page (struct supplemental_page_table *spt, void *va) {
+	struct page key;
+	struct hash_elem *e;
 
-	return page;
+	key.va = pg_round_down (va);
+	e = hash_find (&spt->pages, &key.spt_elem);
+	return e != NULL ? hash_entry (e, struct page, spt_elem) : NULL;
 }
 
 /* Insert PAGE into spt with validation. */
 bool
-spt_insert_page (struct supplemental_page_table *spt UNUSED,
-		struct page *page UNUSED) {
-	int succ = false;
-	/* TODO: Fill this function. */
-
-	return succ;
+spt_insert_page (struct supplemental_page_table *spt,
+		struct page *page) {
+	return hash_insert (&spt->pages, &page->spt_elem) == NULL;
 }
 
 void
 spt_remove_page (struct supplemental_page_table *spt, struct page *page) {
+	if (page->locked)
+		page->owner->locked_cnt--;
+	file_readahead_cancel (page);
+	hash_delete (&spt->pages, &page->spt_elem);
 	vm_dealloc_page (page);
-	return true;
 }
 
-/* Get the struct frame, that will be evicted. */
+/* Removes FRAME from the frame table, moving the scanners that point at
+ * it along.  Must be called with frame_lock held. */
+static void
+frame_table_remove (struct frame *frame) {
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+
+	if (clock_hand == &frame->elem)
+		clock_hand = list_next (clock_hand);
+	if (ksm_cursor == &frame->elem)
+		ksm_cursor = list_next (ksm_cursor);
+	if (frame->ksm_unstable) {
+		hash_delete (&ksm_unstable, &frame->ksm_elem);
+		frame->ksm_unstable = false;
+	}
+	list_remove (&frame->elem);
+}
+
+/* Get the struct frame, that will be evicted.
+ * Sweeps the frame table with a clock hand, giving every recently accessed
+ * page a second chance.  If OWNER is nonnull, only OWNER's pages are
+ * considered.  The victim is removed from the frame table.  Returns NULL
+ * if two full sweeps find nothing to evict.
+ * Must be called with frame_lock held. */
 static struct frame *
-vm_get_victim (void) {
-	struct frame *victim = NULL;
-	 /* TODO: The policy for eviction is up to you. */
+vm_get_victim (struct thread *owner) {
+	size_t budget = 2 * list_size (&frame_table);
 
-	return victim;
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+
+	while (budget-- > 0) {
+		struct frame *frame;
+		struct page *page;
+
+		if (clock_hand == NULL || clock_hand == list_end (&frame_table))
+			clock_hand = list_begin (&frame_table);
+		frame = list_entry (clock_hand, struct frame, elem);
+		page = frame->page;
+		clock_hand = list_next (clock_hand);
+
+		if (frame->pinned || page->locked
+				|| (owner != NULL && page->owner != owner))
+			continue;
+		/* Pages of a sequential scan get no second chance: the scan has
+		 * moved past them by the time the hand comes around. */
+		if (page->advice != MADV_SEQUENTIAL && (frame->referenced
+					|| pml4_is_accessed (page->owner->pml4, page->va))) {
+			frame->referenced = false;
+			pml4_set_accessed (page->owner->pml4, page->va, false);
+		} else {
+			frame_table_remove (frame);
+			return frame;
+		}
+	}
+	return NULL;
 }
 
-/* Evict one page and return the corresponding frame.
+/* Evict one page, of OWNER if nonnull, and return the corresponding frame.
  * Return NULL on error.*/
 static struct frame *
-vm_evict_frame (void) {
-	struct frame *victim UNUSED = vm_get_victim ();
-	/* TODO: swap out the victim and return the evicted frame. */
+vm_evict_frame (struct thread *owner) {
+	struct frame *victim;
+	struct page *page;
+	size_t tries;
 
-	return NULL;
+	lock_acquire (&frame_lock);
+	for (tries = list_size (&frame_table); ; tries--) {
+		victim = tries > 0 ? vm_get_victim (owner) : NULL;
+		if (victim == NULL) {
+			lock_release (&frame_lock);
+			return NULL;
+		}
+
+		/* Unmap first, so that the owner faults instead of touching the
+		 * frame while it is written out, and keep the frame pinned
+		 * meanwhile, so that the fault waits for us.  The write itself
+		 * runs without frame_lock, which faults on other pages need. */
+		page = victim->page;
+		pml4_clear_page (page->owner->pml4, page->va);
+		victim->pinned = true;
+		lock_release (&frame_lock);
+
+		if (swap_out (page))
+			break;
+
+		/* Both the compressed tier and the swap disk are full.  Put the
+		 * page back as it was and try another, which may still compress
+		 * or turn out to be all zeros. */
+		lock_acquire (&frame_lock);
+		pml4_set_page (page->owner->pml4, page->va, victim->kva,
+				page->writable);
+		list_push_back (&frame_table, &victim->elem);
+		victim->pinned = false;
+		cond_broadcast (&unpin_cond, &frame_lock);
+	}
+	vmstat_count (VMSTAT_EVICT);
+
+	lock_acquire (&frame_lock);
+	page->frame = NULL;
+	page->owner->rss--;
+	victim->page = NULL;
+	victim->pinned = false;
+	cond_broadcast (&unpin_cond, &frame_lock);
+	lock_release (&frame_lock);
+
+	return victim;
+}
+
+/* Evicts pages in the background whenever the user pool runs low. */
+static void
+reclaim_daemon (void *aux UNUSED) {
+	for (;;) {
+		sema_down (&reclaim_sema);
+		while (palloc_free_cnt (PAL_USER) < reclaim_high) {
+			struct frame *frame;
+
+			/* Cached file data goes first, since it can be read back
+			 * from the file if needed again. */
+			if (page_cache_shrink ())
+				continue;
+			frame = vm_evict_frame (NULL);
+
+			if (frame == NULL)
+				break;
+			palloc_free_page (frame->kva);
+			free (frame);
+		}
+	}
+}
+
+/* Returns a new frame for the user page at KVA, or NULL if memory is
+ * exhausted. */
+static struct frame *
+frame_create (void *kva) {
+	struct frame *frame = malloc (sizeof *frame);
+
+	if (frame == NULL)
+		return NULL;
+	frame->kva = kva;
+	frame->page = NULL;
+	frame->pinned = false;
+	frame->referenced = false;
+	frame->checksum = 0;
+	frame->ksm_unstable = false;
+	return frame;
+}
+
+/* Allocates a frame from the user pool without evicting anything.
+ * Returns NULL if the pool is exhausted. */
+static struct frame *
+vm_try_get_frame (void) {
+	struct frame *frame;
+	void *kva = palloc_get_page (PAL_USER);
+
+	if (kva == NULL)
+		return NULL;
+	frame = frame_create (kva);
+	if (frame == NULL)
+		palloc_free_page (kva);
+	return frame;
 }
 
 /* palloc() and get frame. If there is no available page, evict the page
- * and return it. This always return valid address. That is, if the user pool
- * memory is full, this function evicts the frame to get the available memory
- * space.*/
+ * and return it. That is, if the user pool memory is full, this function
+ * evicts the frame to get the available memory space.  If OWNER is at its
+ * resident set limit, one of its own pages is evicted instead, so that it
+ * does not push other processes out.  Returns NULL if nothing can be
+ * evicted, because every page is pinned or locked or swap is full; the
+ * fault that needed the frame then fails. */
 static struct frame *
-vm_get_frame (void) {
+vm_get_frame (struct thread *owner) {
 	struct frame *frame = NULL;
-	/* TODO: Fill this function. */
 
-	ASSERT (frame != NULL);
-	ASSERT (frame->page == NULL);
+	if (owner->rss_limit != 0 && owner->rss >= owner->rss_limit)
+		frame = vm_evict_frame (owner);
+	if (frame == NULL)
+		frame = vm_try_get_frame ();
+	if (frame == NULL && page_cache_shrink ())
+		frame = vm_try_get_frame ();
+	if (palloc_free_cnt (PAL_USER) < reclaim_low)
+		sema_up (&reclaim_sema);
+	if (frame == NULL)
+		frame = vm_evict_frame (NULL);
+
+	ASSERT (frame == NULL || frame->page == NULL);
 	return frame;
 }
 
-/* Growing the stack. */
+/* Releases the frame of PAGE, if any, and unmaps PAGE from its owner.
+ * Waits for the frame to be unpinned first. */
+void
+vm_free_frame (struct page *page) {
+	struct frame *frame;
+
+	lock_acquire (&frame_lock);
+	if (page->ro_mapped) {
+		if (page->owner->pml4 != NULL)
+			pml4_clear_page (page->owner->pml4, page->va);
+		page->ro_mapped = false;
+	}
+	while (page->frame != NULL && page->frame->pinned)
+		cond_wait (&unpin_cond, &frame_lock);
+	frame = page->frame;
+	if (frame != NULL) {
+		frame_table_remove (frame);
+		if (page->owner->pml4 != NULL)
+			pml4_clear_page (page->owner->pml4, page->va);
+		page->frame = NULL;
+		page->owner->rss--;
+	}
+	lock_release (&frame_lock);
+
+	if (frame != NULL) {
+		palloc_free_page (frame->kva);
+		free (frame);
+	}
+}
+
+/* Returns a page from the user pool for memory that is not managed
+ * through the frame table, such as the pages of shared objects, evicting
+ * a frame if necessary.  Returns NULL if memory is exhausted. */
+void *
+vm_get_kpage (void) {
+	struct frame *frame = vm_get_frame (thread_current ());
+	void *kva;
+
+	if (frame == NULL)
+		return NULL;
+	kva = frame->kva;
+	free (frame);
+	return kva;
+}
+
+/* Maps PAGE to KVA in its owner's page table, like vm_map_frame() does
+ * for pages with a frame. */
+bool
+vm_set_pte (struct page *page, void *kva) {
+	bool mapped;
+
+	lock_acquire (&frame_lock);
+	mapped = pml4_set_page (page->owner->pml4, page->va, kva, page->writable);
+	lock_release (&frame_lock);
+	return mapped;
+}
+
+/* Unmaps PAGE, mapped with vm_set_pte(), from its owner's page table.
+ * Returns true if PAGE was written to through the mapping. */
+bool
+vm_clear_pte (struct page *page) {
+	uint64_t *pml4;
+	bool dirty = false;
+
+	lock_acquire (&frame_lock);
+	pml4 = page->owner->pml4;
+	if (pml4 != NULL && pml4_get_page (pml4, page->va) != NULL) {
+		dirty = pml4_is_dirty (pml4, page->va);
+		pml4_clear_page (pml4, page->va);
+	}
+	lock_release (&frame_lock);
+	return dirty;
+}
+
+/* Returns true, and clears the bit, if the accessed bit of PAGE is set in
+ * its owner's page table. */
+bool
+vm_pte_accessed (struct page *page) {
+	uint64_t *pml4;
+	bool accessed = false;
+
+	lock_acquire (&frame_lock);
+	pml4 = page->owner->pml4;
+	if (pml4 != NULL && pml4_is_accessed (pml4, page->va)) {
+		pml4_set_accessed (pml4, page->va, false);
+		accessed = true;
+	}
+	lock_release (&frame_lock);
+	return accessed;
+}
+
+/* Returns true, and clears the bit, if the dirty bit of PAGE is set in its
+ * owner's page table.  Used for writeback: a page written to afterwards is
+ * dirty again, so no modification is lost. */
+bool
+vm_pte_dirty (struct page *page) {
+	uint64_t *pml4;
+	bool dirty = false;
+
+	lock_acquire (&frame_lock);
+	pml4 = page->owner->pml4;
+	if (pml4 != NULL && pml4_is_dirty (pml4, page->va)) {
+		pml4_set_dirty (pml4, page->va, false);
+		dirty = true;
+	}
+	lock_release (&frame_lock);
+	return dirty;
+}
+
+/* Returns true if PAGE is in memory: it has a frame, maps a read-only
+ * shared page, or maps its page in the page cache. */
+bool
+vm_page_resident (struct page *page) {
+	return page->frame != NULL || page->ro_mapped
+		|| (VM_TYPE (page->operations->type) == VM_FILE
+				&& page->file.cache != NULL);
+}
+
+/* Pins the frame of PAGE, waiting for any other thread that has it pinned,
+ * and returns it.  Returns NULL if PAGE is not resident. */
+struct frame *
+vm_pin_frame (struct page *page) {
+	struct frame *frame;
+
+	lock_acquire (&frame_lock);
+	while (page->frame != NULL && page->frame->pinned)
+		cond_wait (&unpin_cond, &frame_lock);
+	frame = page->frame;
+	if (frame != NULL)
+		frame->pinned = true;
+	lock_release (&frame_lock);
+	return frame;
+}
+
+/* Unpins FRAME, which must have been pinned by the caller. */
+void
+vm_unpin_frame (struct frame *frame) {
+	lock_acquire (&frame_lock);
+	ASSERT (frame->pinned);
+	frame->pinned = false;
+	cond_broadcast (&unpin_cond, &frame_lock);
+	lock_release (&frame_lock);
+}
+
+/* Samples the accessed bits of all resident pages every WSS_INTERVAL ticks
+ * and updates the working set estimate of their owners. */
+static void
+wss_daemon (void *aux UNUSED) {
+	for (;;) {
+		struct list_elem *e;
+
+		timer_sleep (WSS_INTERVAL);
+
+		lock_acquire (&frame_lock);
+		wss_epoch++;
+		for (e = list_begin (&frame_table); e != list_end (&frame_table);
+				e = list_next (e)) {
+			struct frame *frame = list_entry (e, struct frame, elem);
+			struct page *page = frame->page;
+			struct thread *owner = page->owner;
+
+			/* First page of OWNER in this sweep: retire the last sample
+			 * into the average, rounding up so that a steady working set
+			 * is reached exactly. */
+			if (owner->ws_epoch != wss_epoch) {
+				owner->wss = (3 * owner->wss + owner->ws_count + 3) / 4;
+				owner->ws_count = 0;
+				owner->ws_epoch = wss_epoch;
+			}
+			if (pml4_is_accessed (owner->pml4, page->va)) {
+				pml4_set_accessed (owner->pml4, page->va, false);
+				frame->referenced = true;
+				owner->ws_count++;
+			}
+		}
+		lock_release (&frame_lock);
+	}
+}
+
+/* Hash table helpers for the KSM tables. */
+static uint64_t
+ksm_node_hash (const struct hash_elem *e, void *aux UNUSED) {
+	return hash_entry (e, struct ksm_node, elem)->checksum;
+}
+
+static bool
+ksm_node_less (const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED) {
+	return hash_entry (a, struct ksm_node, elem)->checksum
+		< hash_entry (b, struct ksm_node, elem)->checksum;
+}
+
+static uint64_t
+ksm_frame_hash (const struct hash_elem *e, void *aux UNUSED) {
+	return hash_entry (e, struct frame, ksm_elem)->checksum;
+}
+
+static bool
+ksm_frame_less (const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED) {
+	return hash_entry (a, struct frame, ksm_elem)->checksum
+		< hash_entry (b, struct frame, ksm_elem)->checksum;
+}
+
+/* Drops a reference to NODE, freeing it with the last one. */
+void
+vm_ksm_put (struct ksm_node *node) {
+	bool last;
+
+	lock_acquire (&frame_lock);
+	last = --node->ref_cnt == 0;
+	if (last)
+		hash_delete (&ksm_stable, &node->elem);
+	lock_release (&frame_lock);
+
+	if (last) {
+		palloc_free_page (node->kva);
+		free (node);
+	}
+}
+
+/* Makes the page in FRAME map NODE instead, if their contents are equal.
+ * Returns true if so; FRAME is then out of the frame table and the caller
+ * owns it.  Must be called with frame_lock held. */
+static bool
+ksm_merge (struct frame *frame, struct ksm_node *node) {
+	struct page *page = frame->page;
+	enum intr_level old_level;
+	bool merged = false;
+
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+
+	old_level = intr_disable ();
+	if (!memcmp (frame->kva, node->kva, PGSIZE)
+			&& pml4_set_page (page->owner->pml4, page->va, node->kva, false)) {
+		page->anon.store = ANON_KSM;
+		page->anon.ksm = node;
+		page->frame = NULL;
+		page->ro_mapped = true;
+		page->owner->rss--;
+		node->ref_cnt++;
+		frame_table_remove (frame);
+		merged = true;
+	}
+	intr_set_level (old_level);
+	return merged;
+}
+
+/* Scans FRAME for merging.  Must be called with frame_lock held. */
+static void
+ksm_scan_frame (struct frame *frame) {
+	struct page *page = frame->page;
+	struct ksm_node *node;
+	struct frame *twin;
+	struct ksm_node node_key;
+	struct frame frame_key;
+	struct hash_elem *e;
+	uint64_t checksum;
+
+	if (frame->pinned || page->locked
+			|| VM_TYPE (page->operations->type) != VM_ANON)
+		return;
+
+	/* Take FRAME out of the unstable table before its key changes. */
+	if (frame->ksm_unstable) {
+		hash_delete (&ksm_unstable, &frame->ksm_elem);
+		frame->ksm_unstable = false;
+	}
+	checksum = hash_bytes (frame->kva, PGSIZE);
+	if (checksum != frame->checksum) {
+		frame->checksum = checksum;
+		return;
+	}
+
+	/* Stable contents: merge with an existing node... */
+	node_key.checksum = checksum;
+	e = hash_find (&ksm_stable, &node_key.elem);
+	if (e != NULL) {
+		if (ksm_merge (frame, hash_entry (e, struct ksm_node, elem))) {
+			palloc_free_page (frame->kva);
+			free (frame);
+		}
+		return;
+	}
+
+	/* ...or with another candidate, which then becomes a node... */
+	frame_key.checksum = checksum;
+	e = hash_find (&ksm_unstable, &frame_key.ksm_elem);
+	if (e == NULL) {
+		/* ...or wait for a twin to show up. */
+		hash_insert (&ksm_unstable, &frame->ksm_elem);
+		frame->ksm_unstable = true;
+		return;
+	}
+	twin = hash_entry (e, struct frame, ksm_elem);
+	node = malloc (sizeof *node);
+	if (node == NULL)
+		return;
+	node->checksum = checksum;
+	node->kva = twin->kva;
+	node->ref_cnt = 0;
+
+	/* TWIN's page maps its own frame read-only through NODE, so this
+	 * merge cannot fail on contents. */
+	if (!memcmp (frame->kva, twin->kva, PGSIZE) && ksm_merge (twin, node)) {
+		hash_insert (&ksm_stable, &node->elem);
+		free (twin);
+		if (ksm_merge (frame, node)) {
+			palloc_free_page (frame->kva);
+			free (frame);
+		}
+	} else
+		free (node);
+}
+
+/* Clears the unstable flag of the frame that E is embedded in. */
 static void
-vm_stack_growth (void *addr UNUSED) {
+ksm_unstable_forget (struct hash_elem *e, void *aux UNUSED) {
+	hash_entry (e, struct frame, ksm_elem)->ksm_unstable = false;
 }
 
-/* Handle the fault on write_protected page */
+/* Scans the frame table for pages to merge, a batch at a time. */
+static void
+ksm_daemon (void *aux UNUSED) {
+	for (;;) {
+		timer_sleep (KSM_INTERVAL);
+
+		lock_acquire (&frame_lock);
+		for (int i = 0; i < KSM_BATCH; i++) {
+			struct frame *frame;
+
+			if (ksm_cursor == NULL)
+				ksm_cursor = list_begin (&frame_table);
+			if (ksm_cursor == list_end (&frame_table)) {
+				/* End of a pass.  Candidates must show up again in the next
+				 * one, so that the unstable table does not go stale. */
+				hash_clear (&ksm_unstable, ksm_unstable_forget);
+				ksm_cursor = NULL;
+				break;
+			}
+			frame = list_entry (ksm_cursor, struct frame, elem);
+			ksm_cursor = list_next (ksm_cursor);
+			ksm_scan_frame (frame);
+		}
+		lock_release (&frame_lock);
+	}
+}
+
+/* Returns true if a fault at ADDR looks like an access to the user stack:
+ * at or above the stack pointer (less the 8 bytes a PUSH writes below
+ * it), and inside the stack limit but above its guard page.  For a fault
+ * in the kernel, the user stack pointer is the one saved on entry to the
+ * system call. */
 static bool
-vm_handle_wp (struct page *page UNUSED) {
+is_stack_access (struct intr_frame *f, void *addr, bool user) {
+	uintptr_t rsp = user ? f->rsp : thread_current ()->user_rsp;
+	uintptr_t guard = USER_STACK - vm_stack_limit * PGSIZE;
+
+	return (uintptr_t) addr >= guard + PGSIZE
+		&& (uintptr_t) addr < USER_STACK
+		&& (uintptr_t) addr + 8 >= rsp;
+}
+
+/* Growing the stack.
+ * Adds all pages from ADDR up to the current bottom of the stack, plus up
+ * to STACK_PREFAULT_PAGES below ADDR, and claims the faulting page.  The
+ * other new pages are brought in while free frames last, so that a big
+ * stack object or a deep recursion takes a few faults instead of one per
+ * page. */
+static bool
+vm_stack_growth (void *addr) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	uint8_t *fault = pg_round_down (addr);
+	uint8_t *lowest = (uint8_t *) USER_STACK - (vm_stack_limit - 1) * PGSIZE;
+	uint8_t *low, *top;
+
+	for (top = fault; top < (uint8_t *) USER_STACK
+			&& spt_find_page (spt, top) == NULL; top += PGSIZE)
+		if (!vm_alloc_page (VM_ANON | VM_STACK, top, true))
+			return false;
+	for (low = fault; low - PGSIZE >= lowest
+			&& low - fault < STACK_PREFAULT_PAGES * PGSIZE; low -= PGSIZE)
+		if (!vm_alloc_page (VM_ANON | VM_STACK, low - PGSIZE, true))
+			break;
+
+	if (!vm_claim_page (fault))
+		return false;
+	for (uint8_t *va = low; va < top; va += PGSIZE) {
+		struct page *page = spt_find_page (spt, va);
+
+		if (page->frame == NULL && !vm_prefetch_page (page))
+			break;
+	}
+	return true;
+}
+
+/* Returns true if PAGE is known to hold only zeros: an anonymous page
+ * that was never written, or that was all zero when it was swapped out. */
+static bool
+page_is_zero_fill (struct page *page) {
+	switch (VM_TYPE (page->operations->type)) {
+		case VM_UNINIT:
+			return VM_TYPE (page->uninit.type) == VM_ANON
+				&& page->uninit.init == NULL;
+		case VM_ANON:
+			return page->anon.store == ANON_ZERO;
+		default:
+			return false;
+	}
+}
+
+/* Returns the kernel page that PAGE may map read-only instead of getting
+ * a frame: the zero page for a zero fill page, or the merged copy of a
+ * page merged by KSM.  Returns NULL for any other page. */
+static void *
+page_ro_kva (struct page *page) {
+	if (page_is_zero_fill (page))
+		return zero_page;
+	if (VM_TYPE (page->operations->type) == VM_ANON
+			&& page->anon.store == ANON_KSM)
+		return page->anon.ksm->kva;
+	return NULL;
+}
+
+/* Maps KVA read-only at PAGE; see page_ro_kva(). */
+static bool
+vm_map_ro_page (struct page *page, void *kva) {
+	bool mapped;
+
+	lock_acquire (&frame_lock);
+	mapped = pml4_set_page (page->owner->pml4, page->va, kva, false);
+	page->ro_mapped = mapped;
+	lock_release (&frame_lock);
+	return mapped;
+}
+
+/* Returns true if PAGE may become part of a huge page: a writable
+ * anonymous page that is not in memory and holds only zeros. */
+static bool
+thp_page_ok (struct page *page) {
+	if (page == NULL || !page->writable || page_get_type (page) != VM_ANON
+			|| vm_page_resident (page) || page->readahead != RA_NONE)
+		return false;
+	if (page_is_zero_fill (page))
+		return true;
+
+	/* A page of a segment without file data, i.e. of .bss. */
+	if (VM_TYPE (page->operations->type) == VM_UNINIT
+			&& page->uninit.init != NULL) {
+		struct file_page *aux = page->uninit.aux;
+		return aux != NULL && aux->read_bytes == 0;
+	}
+	return false;
+}
+
+/* Tries to bring in PAGE, and the rest of its HPGSIZE aligned block, with
+ * a huge page.  Returns false, with nothing changed, if the block does not
+ * qualify or memory is short. */
+static bool
+vm_thp_claim (struct page *page) {
+	struct thread *owner = page->owner;
+	uint8_t *base = (uint8_t *) ((uint64_t) page->va & ~(HPGSIZE - 1));
+	struct list frames;
+	struct list_elem *e;
+	uint8_t *kva;
+	bool mapped;
+	size_t i;
+
+	if (owner->rss_limit != 0 && owner->rss + THP_PAGES > owner->rss_limit)
+		return false;
+	for (i = 0; i < THP_PAGES; i++)
+		if (!thp_page_ok (spt_find_page (&owner->spt, base + i * PGSIZE)))
+			return false;
+
+	if (palloc_free_cnt (PAL_USER) < reclaim_low + THP_PAGES)
+		goto fallback;
+	kva = palloc_get_aligned (PAL_USER, THP_PAGES);
+	if (kva == NULL)
+		goto fallback;
+	list_init (&frames);
+	for (i = 0; i < THP_PAGES; i++) {
+		struct frame *frame = frame_create (kva + i * PGSIZE);
+
+		if (frame == NULL)
+			goto free;
+		list_push_back (&frames, &frame->elem);
+	}
+	lock_acquire (&frame_lock);
+	mapped = pml4_set_huge_page (owner->pml4, base, kva, true);
+	lock_release (&frame_lock);
+	if (!mapped)
+		goto free;
+
+	/* The owner is in this fault, and the frames are not in the frame
+	 * table yet, so nobody else looks at the pages meanwhile. */
+	for (e = list_begin (&frames), i = 0; e != list_end (&frames);
+			e = list_next (e), i++) {
+		struct frame *frame = list_entry (e, struct frame, elem);
+		struct page *p = spt_find_page (&owner->spt, base + i * PGSIZE);
+
+		frame->page = p;
+		p->frame = frame;
+		if (!swap_in (p, frame->kva))
+			goto unmap;
+	}
+
+	lock_acquire (&frame_lock);
+	while (!list_empty (&frames))
+		list_push_back (&frame_table, list_pop_front (&frames));
+	owner->rss += THP_PAGES;
+	lock_release (&frame_lock);
+	if (palloc_free_cnt (PAL_USER) < reclaim_low)
+		sema_up (&reclaim_sema);
+	return true;
+
+unmap:
+	/* Undo the pages brought in so far.  Every page of the block was
+	 * zero, so an initialized page is simply zero fill again. */
+	lock_acquire (&frame_lock);
+	pml4_clear_huge_page (owner->pml4, base);
+	lock_release (&frame_lock);
+	for (i = 0; i < THP_PAGES; i++) {
+		struct page *p = spt_find_page (&owner->spt, base + i * PGSIZE);
+
+		p->frame = NULL;
+		if (VM_TYPE (p->operations->type) == VM_ANON)
+			p->anon.store = ANON_ZERO;
+	}
+free:
+	while (!list_empty (&frames))
+		free (list_entry (list_pop_front (&frames), struct frame, elem));
+	palloc_free_multiple (kva, THP_PAGES);
+fallback:
+	vmstat_count (VMSTAT_THP_FALLBACK);
+	return false;
+}
+
+/* Handle the fault on write_protected page.
+ * The only write protected pages that may be written are those that map
+ * the zero page or a merged page; they get their own frame now. */
+static bool
+vm_handle_wp (struct page *page) {
+	if (!page->ro_mapped || !page->writable)
+		return false;
+
+	/* Drop the zero page mapping, and its TLB entry, before replacing it. */
+	lock_acquire (&frame_lock);
+	pml4_clear_page (page->owner->pml4, page->va);
+	page->ro_mapped = false;
+	lock_release (&frame_lock);
+	return vm_do_claim_page (page);
+}
+
+/* Returns the inode of the file that PAGE is loaded from, or NULL if PAGE
+ * is not backed by a file.  Pages with the same backing inode belong to the
+ * same VM object for the purpose of fault-around. */
+static struct inode *
+page_backing_inode (struct page *page) {
+	if (VM_TYPE (page->operations->type) == VM_UNINIT) {
+		struct file_page *aux = page->uninit.aux;
+		return page->uninit.init != NULL && aux != NULL
+			? file_get_inode (aux->file) : NULL;
+	}
+	if (VM_TYPE (page->operations->type) == VM_FILE)
+		return file_get_inode (page->file.file);
+	return NULL;
+}
+
+/* Returns the counter for a fault on PAGE by page type. */
+static enum vmstat_event
+page_fault_event (struct page *page) {
+	switch (VM_TYPE (page->operations->type)) {
+		case VM_UNINIT:
+			return VMSTAT_FAULT_UNINIT;
+		case VM_FILE:
+			return VMSTAT_FAULT_FILE;
+		default:
+			return VMSTAT_FAULT_ANON;
+	}
+}
+
+/* Returns true if bringing in PAGE takes disk I/O. */
+static bool
+page_fault_is_major (struct page *page) {
+	switch (VM_TYPE (page->operations->type)) {
+		case VM_UNINIT:
+			if (VM_TYPE (page->uninit.type) == VM_FILE)
+				return !file_backed_cached (page);
+			return page->uninit.init != NULL;
+		case VM_FILE:
+			return !file_backed_cached (page);
+		case VM_ANON:
+			return page->anon.store == ANON_SWAP;
+		default:
+			return false;
+	}
 }
 
 /* Return true on success */
 bool
-vm_try_handle_fault (struct intr_frame *f UNUSED, void *addr UNUSED,
-		bool user UNUSED, bool write UNUSED, bool not_present UNUSED) {
-	struct supplemental_page_table *spt UNUSED = &thread_current ()->spt;
+vm_try_handle_fault (struct intr_frame *f, void *addr,
+		bool user, bool write, bool not_present) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
 	struct page *page = NULL;
-	/* TODO: Validate the fault */
-	/* TODO: Your code goes here */
+	struct inode *inode;
+	void *ro_kva;
 
-	return vm_do_claim_page (page);
+	if (addr == NULL || is_kernel_vaddr (addr))
+		return false;
+
+	page = spt_find_page (spt, addr);
+	if (page == NULL) {
+		if (!not_present || !is_stack_access (f, addr, user)
+				|| !vm_stack_growth (addr))
+			return false;
+		vmstat_count (VMSTAT_FAULT_STACK);
+		vmstat_count (VMSTAT_FAULT_MINOR);
+		return true;
+	}
+	if (!not_present) {
+		vmstat_count (VMSTAT_FAULT_WP);
+		if (!write || !vm_handle_wp (page))
+			return false;
+		vmstat_count (VMSTAT_FAULT_COW);
+		vmstat_count (VMSTAT_FAULT_MINOR);
+		return true;
+	}
+	if (write && !page->writable)
+		return false;
+
+	/* PAGE may be in the middle of being read ahead or evicted by another
+	 * thread.  Wait for either to finish before looking at its frame. */
+	file_readahead_cancel (page);
+	lock_acquire (&frame_lock);
+	while (page->frame != NULL && page->frame->pinned)
+		cond_wait (&unpin_cond, &frame_lock);
+	lock_release (&frame_lock);
+	vmstat_count (page_fault_event (page));
+	if (page->frame != NULL) {
+		vmstat_count (VMSTAT_FAULT_MINOR);
+		return true;
+	}
+	if (vm_thp_enabled && vm_thp_claim (page)) {
+		vmstat_count (VMSTAT_THP_FAULT);
+		vmstat_count (VMSTAT_FAULT_MINOR);
+		return true;
+	}
+	if (!write && (ro_kva = page_ro_kva (page)) != NULL) {
+		vmstat_count (VMSTAT_FAULT_MINOR);
+		return vm_map_ro_page (page, ro_kva);
+	}
+
+	vmstat_count (page_fault_is_major (page)
+			? VMSTAT_FAULT_MAJOR : VMSTAT_FAULT_MINOR);
+	inode = page_backing_inode (page);
+	if (!vm_do_claim_page (page))
+		return false;
+	if (inode != NULL && page->advice != MADV_RANDOM)
+		vm_fault_around (page, inode);
+	if (VM_TYPE (page->operations->type) == VM_FILE)
+		file_readahead (page);
+	return true;
+}
+
+/* Maps in the non-resident pages of INODE around the just claimed PAGE, as
+ * long as frames are available without eviction.  Prefetched pages start
+ * with their accessed bit clear, so the clock reclaims them first if they
+ * turn out to be useless. */
+static void
+vm_fault_around (struct page *page, struct inode *inode) {
+	struct supplemental_page_table *spt = &page->owner->spt;
+	uint8_t *start = (uint8_t *) ((uint64_t) page->va
+			& ~((uint64_t) FAULT_AROUND_PAGES * PGSIZE - 1));
+
+	for (int i = 0; i < FAULT_AROUND_PAGES; i++) {
+		void *va = start + i * PGSIZE;
+		struct page *neighbor;
+
+		if (va == page->va)
+			continue;
+		neighbor = spt_find_page (spt, va);
+		if (neighbor == NULL || vm_page_resident (neighbor)
+				|| neighbor->readahead != RA_NONE
+				|| page_backing_inode (neighbor) != inode)
+			continue;
+		if (!vm_prefetch_page (neighbor))
+			break;
+	}
+}
+
+/* Drops the contents of PAGE for MADV_DONTNEED. */
+static void
+vm_discard_page (struct page *page) {
+	file_readahead_cancel (page);
+	switch (VM_TYPE (page->operations->type)) {
+		case VM_ANON:
+			anon_discard (page);
+			break;
+		case VM_FILE:
+			file_backed_discard (page);
+			break;
+		default:
+			/* Uninit pages hold nothing yet, and shared pages belong to
+			 * their object. */
+			break;
+	}
+}
+
+/* Checks that the LENGTH bytes at ADDR are a page aligned range of user
+ * memory, and stores the number of pages in the range in *PAGE_CNT. */
+static bool
+user_range_check (void *addr, size_t length, size_t *page_cnt) {
+	if (pg_ofs (addr) != 0 || !is_user_vaddr (addr))
+		return false;
+	*page_cnt = DIV_ROUND_UP (length, PGSIZE);
+	return *page_cnt <= (KERN_BASE - (uint64_t) addr) / PGSIZE;
+}
+
+/* Applies ADVICE to the pages of the current process in the LENGTH bytes
+ * at ADDR.  Returns false if ADDR is not page aligned, the range is not
+ * in user memory or ADVICE is unknown, and also if part of the range is
+ * not mapped or MADV_DONTNEED meets a locked page, in which case the rest
+ * of the range is still advised. */
+bool
+vm_madvise (void *addr, size_t length, int advice) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	size_t page_cnt;
+	bool success = true;
+
+	if (advice < MADV_NORMAL || advice > MADV_DONTNEED
+			|| !user_range_check (addr, length, &page_cnt))
+		return false;
+
+	for (size_t i = 0; i < page_cnt; i++) {
+		struct page *page = spt_find_page (spt, (uint8_t *) addr + i * PGSIZE);
+
+		if (page == NULL || (advice == MADV_DONTNEED && page->locked)) {
+			success = false;
+			continue;
+		}
+		switch (advice) {
+			case MADV_WILLNEED:
+				/* Only pages that need memory and have contents to load. */
+				if (!vm_page_resident (page) && page_ro_kva (page) == NULL
+						&& VM_TYPE (page->operations->type) != VM_SHARED)
+					file_readahead_page (page);
+				break;
+			case MADV_DONTNEED:
+				vm_discard_page (page);
+				break;
+			default:
+				page->advice = advice;
+				break;
+		}
+	}
+	return success;
+}
+
+/* Makes PAGE resident and keeps it so until it is unlocked.  A writable
+ * page that maps a read-only shared page gets its own frame now, so that
+ * the first write to it does not fault. */
+static bool
+vm_lock_page (struct page *page) {
+	bool resident;
+
+	/* Once PAGE is locked, no new eviction picks it, but one may be under
+	 * way already. */
+	file_readahead_cancel (page);
+	lock_acquire (&frame_lock);
+	page->locked = true;
+	while (page->frame != NULL && page->frame->pinned)
+		cond_wait (&unpin_cond, &frame_lock);
+	/* A file backed page maps its cache page, which is not evicted while
+	 * a locked page maps it. */
+	resident = page->frame != NULL
+		|| (VM_TYPE (page->operations->type) == VM_FILE
+				&& page->file.cache != NULL);
+	lock_release (&frame_lock);
+
+	if (resident || (page->ro_mapped && !page->writable))
+		return true;
+	if (page->ro_mapped ? vm_handle_wp (page) : vm_do_claim_page (page))
+		return true;
+	page->locked = false;
+	return false;
+}
+
+/* Locks the pages of the current process in the LENGTH bytes at ADDR in
+ * memory, bringing them in first.  Locked pages are never evicted or
+ * merged.  Returns false if the range is not mapped user memory, or if
+ * the process would have more than vm_mlock_limit pages locked.  If a page
+ * cannot be brought in, the pages before it stay locked. */
+bool
+vm_mlock (void *addr, size_t length) {
+	struct thread *t = thread_current ();
+	uint8_t *start = pg_round_down (addr);
+	size_t page_cnt, new_cnt = 0;
+
+	if (!user_range_check (start, length + pg_ofs (addr), &page_cnt))
+		return false;
+	for (size_t i = 0; i < page_cnt; i++) {
+		struct page *page = spt_find_page (&t->spt, start + i * PGSIZE);
+
+		if (page == NULL)
+			return false;
+		if (!page->locked)
+			new_cnt++;
+	}
+	if (t->locked_cnt + new_cnt > vm_mlock_limit)
+		return false;
+
+	for (size_t i = 0; i < page_cnt; i++) {
+		struct page *page = spt_find_page (&t->spt, start + i * PGSIZE);
+
+		if (page->locked)
+			continue;
+		if (!vm_lock_page (page))
+			return false;
+		t->locked_cnt++;
+	}
+	return true;
+}
+
+/* Unlocks the pages of the current process in the LENGTH bytes at ADDR.
+ * Returns false if the range is not user memory or part of it is not
+ * mapped. */
+bool
+vm_munlock (void *addr, size_t length) {
+	struct thread *t = thread_current ();
+	uint8_t *start = pg_round_down (addr);
+	size_t page_cnt;
+	bool all_mapped = true;
+
+	if (!user_range_check (start, length + pg_ofs (addr), &page_cnt))
+		return false;
+	for (size_t i = 0; i < page_cnt; i++) {
+		struct page *page = spt_find_page (&t->spt, start + i * PGSIZE);
+
+		if (page == NULL)
+			all_mapped = false;
+		else if (page->locked) {
+			page->locked = false;
+			t->locked_cnt--;
+		}
+	}
+	return all_mapped;
+}
+
+/* Charges one page that cannot be evicted, such as a page of a shared
+ * object, to T as if T had locked it: it counts toward T's resident set
+ * and toward its vm_mlock_limit.  Returns false, charging nothing, if T
+ * has vm_mlock_limit pages locked already. */
+bool
+vm_charge_locked (struct thread *t) {
+	bool ok;
+
+	lock_acquire (&frame_lock);
+	ok = t->locked_cnt < vm_mlock_limit;
+	if (ok) {
+		t->locked_cnt++;
+		t->rss++;
+	}
+	lock_release (&frame_lock);
+	return ok;
+}
+
+/* Drops a charge taken by vm_charge_locked(). */
+void
+vm_uncharge_locked (struct thread *t) {
+	lock_acquire (&frame_lock);
+	t->locked_cnt--;
+	t->rss--;
+	lock_release (&frame_lock);
+}
+
+/* Brings PAGE in, for writing if WRITE, and pins its frame.  Pages that
+ * map a shared object or, for reading, a read-only shared page have no
+ * frame to pin; their mapping stays in place for as long as the owner does
+ * not unmap them.  A file backed page pins its cache page instead. */
+static bool
+vm_pin_page (struct page *page, bool write) {
+	if (VM_TYPE (page->operations->type) == VM_SHARED)
+		return pml4_get_page (page->owner->pml4, page->va) != NULL
+			|| shared_page_claim (page);
+	if (page_get_type (page) == VM_FILE)
+		for (;;) {
+			file_readahead_cancel (page);
+			if ((VM_TYPE (page->operations->type) == VM_UNINIT
+						|| page->file.cache == NULL)
+					&& !vm_do_claim_page (page))
+				return false;
+
+			/* Retry if the cache page was evicted meanwhile. */
+			if (page_cache_pin (page))
+				return true;
+		}
+
+	for (;;) {
+		file_readahead_cancel (page);
+		if (page->ro_mapped) {
+			if (!write)
+				return true;
+			if (!vm_handle_wp (page))
+				return false;
+		} else if (page->frame == NULL && !vm_do_claim_page (page))
+			return false;
+
+		/* Retry if an eviction took the frame away meanwhile. */
+		if (vm_pin_frame (page) != NULL)
+			return true;
+	}
+}
+
+/* Unpins the frames that vm_pin_user() pinned for the pages from START up
+ * to END. */
+static void
+vm_unpin_pages (const uint8_t *start, const uint8_t *end) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+
+	for (; start < end; start += PGSIZE) {
+		struct page *page = spt_find_page (spt, (void *) start);
+
+		if (VM_TYPE (page->operations->type) == VM_FILE)
+			page_cache_unpin (page);
+		else if (page->frame != NULL)
+			vm_unpin_frame (page->frame);
+	}
+}
+
+/* Brings in and pins the pages of the SIZE bytes of user memory at UADDR
+ * in the current process, so that a system call can access them without
+ * faulting and without racing with eviction.  If WRITE, the pages must be
+ * writable.  Returns false, with nothing pinned, if part of the range is
+ * not mapped.  Undo with vm_unpin_user(). */
+bool
+vm_pin_user (const void *uaddr, size_t size, bool write) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	const uint8_t *start = pg_round_down (uaddr);
+	const uint8_t *end = (const uint8_t *) uaddr + size;
+	const uint8_t *upage;
+
+	if (size == 0)
+		return true;
+	if (!is_user_vaddr (uaddr) || end < (const uint8_t *) uaddr
+			|| !is_user_vaddr (end - 1))
+		return false;
+	for (upage = start; upage < end; upage += PGSIZE) {
+		struct page *page = spt_find_page (spt, (void *) upage);
+
+		if (page == NULL || (write && !page->writable)
+				|| !vm_pin_page (page, write)) {
+			vm_unpin_pages (start, upage);
+			return false;
+		}
+	}
+	return true;
+}
+
+/* Unpins the pages pinned by vm_pin_user (UADDR, SIZE, ...). */
+void
+vm_unpin_user (const void *uaddr, size_t size) {
+	if (size != 0)
+		vm_unpin_pages (pg_round_down (uaddr), (const uint8_t *) uaddr + size);
 }
 
 /* Free the page.
@@ -150,41 +1410,210 @@ vm_dealloc_page (struct page *page) {
 
 /* Claim the page that allocate on VA. */
 bool
-vm_claim_page (void *va UNUSED) {
-	struct page *page = NULL;
-	/* TODO: Fill this function */
+vm_claim_page (void *va) {
+	struct page *page = spt_find_page (&thread_current ()->spt, va);
 
+	if (page == NULL)
+		return false;
 	return vm_do_claim_page (page);
 }
 
 /* Claim the PAGE and set up the mmu. */
 static bool
 vm_do_claim_page (struct page *page) {
-	struct frame *frame = vm_get_frame ();
+	struct frame *frame;
+
+	if (VM_TYPE (page->operations->type) == VM_SHARED)
+		return shared_page_claim (page);
+	if (page_get_type (page) == VM_FILE)
+		return file_backed_claim (page, false);
+	frame = vm_get_frame (page->owner);
+	if (frame == NULL)
+		return false;
+	return vm_map_frame (page, frame);
+}
+
+/* Brings PAGE in if a frame is available without eviction and above the
+ * reclaim reserve.  Used for speculative loads (fault-around and
+ * readahead), which must never push out a page that is actually in use.
+ * Unlike vm_claim_page(), this may be called from a thread other than
+ * PAGE's owner. */
+bool
+vm_prefetch_page (struct page *page) {
+	struct thread *owner = page->owner;
+	struct frame *frame;
+
+	if ((owner->rss_limit != 0 && owner->rss >= owner->rss_limit)
+			|| palloc_free_cnt (PAL_USER) <= reclaim_low)
+		return false;
+	if (page_get_type (page) == VM_FILE)
+		return file_backed_claim (page, true);
+	frame = vm_try_get_frame ();
+	if (frame == NULL)
+		return false;
+	return vm_map_frame (page, frame);
+}
+
+/* Loads the contents of PAGE into FRAME, maps it in the owner's page table
+ * and publishes FRAME in the frame table.  On failure, FRAME is freed.
+ * Page table updates are serialized by frame_lock, since the readahead
+ * daemon maps pages into page tables it does not own. */
+static bool
+vm_map_frame (struct page *page, struct frame *frame) {
+	bool mapped;
 
 	/* Set links */
 	frame->page = page;
 	page->frame = frame;
 
-	/* TODO: Insert page table entry to map page's VA to frame's PA. */
+	if (!swap_in (page, frame->kva))
+		goto fail;
+
+	lock_acquire (&frame_lock);
+	mapped = pml4_set_page (page->owner->pml4, page->va, frame->kva,
+			page->writable);
+	if (mapped) {
+		list_push_back (&frame_table, &frame->elem);
+		page->owner->rss++;
+		page->ro_mapped = false;
+	}
+	lock_release (&frame_lock);
+	if (mapped)
+		return true;
 
-	return swap_in (page, frame->kva);
+fail:
+	page->frame = NULL;
+	palloc_free_page (frame->kva);
+	free (frame);
+	return false;
+}
+
+/* Returns a hash value for page P. */
+static uint64_t
+page_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct page *p = hash_entry (e, struct page, spt_elem);
+	return hash_bytes (&p->va, sizeof p->va);
+}
+
+/* Returns true if page A precedes page B. */
+static bool
+page_less (const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED) {
+	const struct page *pa = hash_entry (a, struct page, spt_elem);
+	const struct page *pb = hash_entry (b, struct page, spt_elem);
+	return pa->va < pb->va;
 }
 
 /* Initialize new supplemental page table */
 void
-supplemental_page_table_init (struct supplemental_page_table *spt UNUSED) {
+supplemental_page_table_init (struct supplemental_page_table *spt) {
+	hash_init (&spt->pages, page_hash, page_less, NULL);
+	list_init (&spt->mmaps);
+}
+
+/* Copies the contents of SRC into DST, bringing both in as needed.  The
+ * copy is done under frame_lock so that neither frame can be evicted
+ * underneath it.  A SRC that maps a read-only shared page is copied from
+ * there, without being brought in. */
+static bool
+copy_page_contents (struct page *dst, struct page *src) {
+	void *shared = page_ro_kva (src);
+
+	for (;;) {
+		if (shared == NULL && src->frame == NULL && !vm_do_claim_page (src))
+			return false;
+		if (dst->frame == NULL && !vm_do_claim_page (dst))
+			return false;
+
+		/* Neither frame may be in the middle of an eviction. */
+		lock_acquire (&frame_lock);
+		while ((src->frame != NULL && src->frame->pinned)
+				|| (dst->frame != NULL && dst->frame->pinned))
+			cond_wait (&unpin_cond, &frame_lock);
+		if ((shared != NULL || src->frame != NULL) && dst->frame != NULL) {
+			memcpy (dst->frame->kva, shared != NULL ? shared : src->frame->kva,
+					PGSIZE);
+			lock_release (&frame_lock);
+			return true;
+		}
+		lock_release (&frame_lock);
+	}
 }
 
 /* Copy supplemental page table from src to dst */
 bool
-supplemental_page_table_copy (struct supplemental_page_table *dst UNUSED,
-		struct supplemental_page_table *src UNUSED) {
+supplemental_page_table_copy (struct supplemental_page_table *dst,
+		struct supplemental_page_table *src) {
+	struct hash_iterator i;
+
+	if (!file_mmap_copy (dst, src))
+		return false;
+
+	hash_first (&i, &src->pages);
+	while (hash_next (&i)) {
+		struct page *src_page = hash_entry (hash_cur (&i), struct page, spt_elem);
+		struct page *dst_page;
+		vm_initializer *init = NULL;
+		struct file_page *aux = NULL;
+		enum vm_type type;
+
+		/* Let a pending readahead of the page settle first. */
+		file_readahead_cancel (src_page);
+
+		type = VM_TYPE (src_page->operations->type);
+		if (type == VM_SHARED) {
+			/* Shared, not copied. */
+			if (!vm_object_map (src_page->shared.obj, src_page->shared.idx,
+						src_page->va, src_page->writable))
+				return false;
+			continue;
+		}
+		if (type == VM_UNINIT) {
+			init = src_page->uninit.init;
+			aux = src_page->uninit.aux;
+			type = src_page->uninit.type;
+		} else if (type == VM_FILE) {
+			init = file_backed_lazy_load;
+			aux = &src_page->file;
+		}
+		if (aux != NULL) {
+			aux = file_page_duplicate (aux);
+			if (aux == NULL)
+				return false;
+			file_mmap_rebind (aux, dst);
+		}
+		if (!vm_alloc_page_with_initializer (type, src_page->va,
+					src_page->writable, init, aux)) {
+			if (aux != NULL)
+				file_page_free (aux);
+			return false;
+		}
+		dst_page = spt_find_page (dst, src_page->va);
+		dst_page->advice = src_page->advice;
+		/* A file backed page of the child maps the same cache page. */
+		if (VM_TYPE (src_page->operations->type) == VM_UNINIT
+				|| type == VM_FILE
+				|| (src_page->frame == NULL && page_is_zero_fill (src_page)))
+			continue;
+
+		if (!copy_page_contents (dst_page, src_page))
+			return false;
+	}
+	return true;
+}
+
+/* Destroys the page that E is embedded in. */
+static void
+page_destructor (struct hash_elem *e, void *aux UNUSED) {
+	struct page *page = hash_entry (e, struct page, spt_elem);
+
+	file_readahead_cancel (page);
+	vm_dealloc_page (page);
 }
 
 /* Free the resource hold by the supplemental page table */
 void
-supplemental_page_table_kill (struct supplemental_page_table *spt UNUSED) {
-	/* TODO: Destroy all the supplemental_page_table hold by thread and
-	 * TODO: writeback all the modified contents to the storage. */
+supplemental_page_table_kill (struct supplemental_page_table *spt) {
+	hash_clear (&spt->pages, page_destructor);
+	file_mmap_kill (spt);
 }
@@ -0,0 +1,27 @@
+/* vmstat.c: Virtual memory event counters. */
+
+#include "vm/vm.h"
+#include <string.h>
+
+static struct vmstat stats;
+
+/* Counts one EVENT. */
+void
+vmstat_count (enum vmstat_event event) {
+	ASSERT (event < VMSTAT_EVENT_CNT);
+	__atomic_fetch_add (&stats.events[event], 1, __ATOMIC_RELAXED);
+}
+
+/* Records a fault that took CYCLES TSC cycles to handle. */
+void
+vmstat_fault_latency (uint64_t cycles) {
+	int bucket = cycles != 0 ? 63 - __builtin_clzll (cycles) : 0;
+
+	__atomic_fetch_add (&stats.fault_latency[bucket], 1, __ATOMIC_RELAXED);
+}
+
+/* Copies the current counters into ST. */
+void
+vmstat_get (struct vmstat *st) {
+	memcpy (st, &stats, sizeof *st);
+}
@@ -0,0 +1,199 @@
+/* zswap.c: Compressed swap cache for anonymous pages.
+ *
+ * The arena is a contiguous run of kernel pages, divided into chunks of
+ * ZSWAP_CHUNK bytes.  A stored page takes a contiguous run of chunks,
+ * found with a first-fit scan of a bitmap, just like the slots of the swap
+ * disk.  Pages are compressed with a small LZ77 codec that favors speed
+ * over ratio: a page is compressed in one pass with a single hash probe
+ * per byte, and decompressed with no bookkeeping at all.
+ *
+ * Compressed format: a sequence of items, each introduced by a control
+ * byte C.
+ *   C < 0x80:  C + 1 literal bytes follow.
+ *   C >= 0x80: a match of (C & 0x7f) + LZ_MIN_MATCH bytes, copied from
+ *              the 16-bit little-endian distance that follows. */
+
+#include "vm/zswap.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+#define ZSWAP_CHUNK 64                  /* Arena allocation unit, bytes. */
+#define ZSWAP_MAX_LEN (PGSIZE / 4 * 3)  /* Don't keep worse than 3:4. */
+
+#define LZ_HASH_BITS 12
+#define LZ_MIN_MATCH 3
+#define LZ_MAX_MATCH (0x7f + LZ_MIN_MATCH)
+#define LZ_MAX_LITERALS 0x80
+
+/* Number of kernel pages in the arena, or 0 to disable zswap.  Set with
+ * the -zswap kernel option. */
+size_t zswap_page_cnt = 64;
+
+static uint8_t *arena;                  /* Compressed pages. */
+static struct bitmap *arena_map;        /* Chunks of ARENA in use. */
+
+/* Protects arena_map and the compressor state below. */
+static struct lock zswap_lock;
+static uint16_t lz_hash[1 << LZ_HASH_BITS]; /* Last position + 1 of a
+                                               3-byte sequence. */
+static uint8_t lz_buf[ZSWAP_MAX_LEN];   /* Compressor output. */
+
+/* Initializes the arena.  If the kernel pool cannot spare ZSWAP_PAGE_CNT
+ * pages, makes do with fewer. */
+void
+zswap_init (void) {
+	lock_init (&zswap_lock);
+	for (; zswap_page_cnt > 0; zswap_page_cnt /= 2) {
+		arena = palloc_get_multiple (0, zswap_page_cnt);
+		if (arena == NULL)
+			continue;
+		arena_map = bitmap_create (zswap_page_cnt * PGSIZE / ZSWAP_CHUNK);
+		if (arena_map != NULL)
+			break;
+		palloc_free_multiple (arena, zswap_page_cnt);
+		arena = NULL;
+	}
+}
+
+/* Hashes the 3 bytes at P. */
+static inline unsigned
+lz_hash3 (const uint8_t *p) {
+	uint32_t v = p[0] | p[1] << 8 | p[2] << 16;
+	return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/* Appends IN[START, END) to OUT as literal runs.  Returns the new output
+ * length, or 0 if it would exceed MAX. */
+static size_t
+lz_literals (const uint8_t *in, size_t start, size_t end, uint8_t *out,
+		size_t op, size_t max) {
+	while (start < end) {
+		size_t n = end - start < LZ_MAX_LITERALS ? end - start : LZ_MAX_LITERALS;
+
+		if (op + 1 + n > max)
+			return 0;
+		out[op++] = n - 1;
+		memcpy (out + op, in + start, n);
+		op += n;
+		start += n;
+	}
+	return op;
+}
+
+/* Compresses the page IN into OUT.  Returns the compressed length, or 0
+ * if it would be longer than MAX.  Must be called with zswap_lock held. */
+static size_t
+lz_compress (const uint8_t *in, uint8_t *out, size_t max) {
+	size_t ip = 0, lit = 0, op = 0;
+
+	memset (lz_hash, 0, sizeof lz_hash);
+	while (ip + LZ_MIN_MATCH <= PGSIZE) {
+		unsigned h = lz_hash3 (in + ip);
+		size_t cand = lz_hash[h];
+		size_t len;
+
+		lz_hash[h] = ip + 1;
+		if (cand == 0 || memcmp (in + cand - 1, in + ip, LZ_MIN_MATCH)) {
+			ip++;
+			continue;
+		}
+
+		/* Extend the match as far as it goes. */
+		cand--;
+		for (len = LZ_MIN_MATCH; ip + len < PGSIZE && len < LZ_MAX_MATCH
+				&& in[cand + len] == in[ip + len]; len++)
+			continue;
+
+		if (ip > lit && (op = lz_literals (in, lit, ip, out, op, max)) == 0)
+			return 0;
+		if (op + 3 > max)
+			return 0;
+		out[op++] = 0x80 | (len - LZ_MIN_MATCH);
+		out[op++] = (ip - cand) & 0xff;
+		out[op++] = (ip - cand) >> 8;
+		ip += len;
+		lit = ip;
+	}
+	return lz_literals (in, lit, PGSIZE, out, op, max);
+}
+
+/* Decompresses LEN bytes at IN into the page OUT. */
+static void
+lz_decompress (const uint8_t *in, size_t len, uint8_t *out) {
+	size_t ip = 0, op = 0;
+
+	while (ip < len) {
+		uint8_t c = in[ip++];
+
+		if (c < 0x80) {
+			size_t n = c + 1;
+
+			ASSERT (ip + n <= len && op + n <= PGSIZE);
+			memcpy (out + op, in + ip, n);
+			ip += n;
+			op += n;
+		} else {
+			size_t n = (c & 0x7f) + LZ_MIN_MATCH;
+			size_t dist;
+
+			ASSERT (ip + 2 <= len);
+			dist = in[ip] | in[ip + 1] << 8;
+			ip += 2;
+			ASSERT (dist != 0 && dist <= op && op + n <= PGSIZE);
+
+			/* Byte by byte: the source may overlap the destination. */
+			for (; n > 0; n--, op++)
+				out[op] = out[op - dist];
+		}
+	}
+	ASSERT (op == PGSIZE);
+}
+
+/* Compresses the page at KVA into the arena and describes where it went
+ * in E.  Returns false if zswap is disabled, the page does not compress
+ * well enough or the arena is full. */
+bool
+zswap_store (const void *kva, struct zswap_entry *e) {
+	size_t len, chunk;
+
+	if (arena == NULL)
+		return false;
+
+	lock_acquire (&zswap_lock);
+	len = lz_compress (kva, lz_buf, sizeof lz_buf);
+	chunk = len != 0
+		? bitmap_scan_and_flip (arena_map, 0, DIV_ROUND_UP (len, ZSWAP_CHUNK),
+				false)
+		: BITMAP_ERROR;
+	if (chunk != BITMAP_ERROR)
+		memcpy (arena + chunk * ZSWAP_CHUNK, lz_buf, len);
+	lock_release (&zswap_lock);
+
+	if (chunk == BITMAP_ERROR)
+		return false;
+	e->chunk = chunk;
+	e->len = len;
+	return true;
+}
+
+/* Decompresses the page described by E into KVA.  E stays allocated. */
+void
+zswap_load (const struct zswap_entry *e, void *kva) {
+	lz_decompress (arena + e->chunk * ZSWAP_CHUNK, e->len, kva);
+}
+
+/* Releases the arena space of E. */
+void
+zswap_free (const struct zswap_entry *e) {
+	lock_acquire (&zswap_lock);
+	bitmap_set_multiple (arena_map, e->chunk,
+			DIV_ROUND_UP (e->len, ZSWAP_CHUNK), false);
+	lock_release (&zswap_lock);
+}